@@ -0,0 +1,329 @@
+#ifndef SUBPAR_CAPACITY_HPP
+#define SUBPAR_CAPACITY_HPP
+
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <cmath>
+
+#ifdef __linux__
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+#include "sanisizer/sanisizer.hpp"
+
+/**
+ * @file capacity.hpp
+ * @brief Parallelize across heterogeneous cores.
+ */
+
+namespace subpar {
+
+/**
+ * @brief Capacity of a CPU core.
+ */
+struct CoreCapacity {
+    /**
+     * Identifier for the core, to be used for pinning workers.
+     * This may be negative if the core's identity is unknown, in which case no pinning is performed.
+     */
+    int id;
+
+    /**
+     * Relative capacity of the core.
+     * Only the ratios between capacities are relevant.
+     * This should be positive.
+     */
+    double capacity;
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline bool read_core_value(const std::string& path, double& value) {
+    std::ifstream handle(path);
+    if (!handle) {
+        return false;
+    }
+    double tmp;
+    if (!(handle >> tmp) || !(tmp > 0)) {
+        return false;
+    }
+    value = tmp;
+    return true;
+}
+
+inline std::vector<CoreCapacity> detect_core_capacities() {
+    std::vector<CoreCapacity> output;
+
+#ifdef __linux__
+    cpu_set_t available;
+    CPU_ZERO(&available);
+    if (sched_getaffinity(0, sizeof(available), &available) != 0) {
+        return output;
+    }
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+        if (CPU_ISSET(c, &available)) {
+            output.push_back(CoreCapacity{ c, 1 });
+        }
+    }
+
+    // Using the same source for all cores, otherwise the capacities are not comparable.
+    const std::string prefix = "/sys/devices/system/cpu/cpu";
+    for (const auto& suffix : { "/cpu_capacity", "/cpufreq/cpuinfo_max_freq" }) {
+        auto copy = output;
+        bool okay = true;
+        for (auto& core : copy) {
+            if (!read_core_value(prefix + std::to_string(core.id) + suffix, core.capacity)) {
+                okay = false;
+                break;
+            }
+        }
+        if (okay) {
+            output.swap(copy);
+            break;
+        }
+    }
+
+    // Fastest cores first, breaking ties by ID to ensure that the ordering is deterministic.
+    std::sort(output.begin(), output.end(), [](const CoreCapacity& left, const CoreCapacity& right) -> bool {
+        if (left.capacity == right.capacity) {
+            return left.id < right.id;
+        } else {
+            return left.capacity > right.capacity;
+        }
+    });
+#endif
+
+    return output;
+}
+
+// Computes the start of each worker's task range, with an extra element at the end containing num_tasks.
+// Assumes that num_workers >= 1, num_tasks >= 1 and cores is not empty; num_workers is capped at num_tasks.
+template<typename Task_>
+std::vector<Task_> capacity_partition(int& num_workers, const Task_ num_tasks, const std::vector<CoreCapacity>& cores) {
+    if (sanisizer::is_greater_than_or_equal(num_workers, num_tasks)) {
+        num_workers = num_tasks;
+    }
+
+    const auto num_cores = cores.size();
+    double total = 0;
+    for (int w = 0; w < num_workers; ++w) {
+        total += cores[w % num_cores].capacity;
+    }
+
+    // Every worker gets at least one task, and the rest are distributed in proportion to each worker's capacity.
+    // Any leftovers from rounding are assigned to the workers with the largest fractional parts, breaking ties by worker ID.
+    const Task_ leftover = num_tasks - num_workers;
+    auto lengths = sanisizer::create<std::vector<Task_> >(num_workers, 1);
+    std::vector<std::pair<double, int> > fractions;
+    sanisizer::reserve(fractions, num_workers);
+    Task_ allocated = 0;
+
+    for (int w = 0; w < num_workers; ++w) {
+        const double ideal = static_cast<double>(leftover) * (cores[w % num_cores].capacity / total);
+        double floored = std::floor(ideal);
+        Task_ extra = (floored >= static_cast<double>(leftover) ? leftover : static_cast<Task_>(floored));
+        if (extra > leftover - allocated) { // protect against accumulated round-off.
+            extra = leftover - allocated;
+        }
+        lengths[w] += extra;
+        allocated += extra;
+        fractions.emplace_back(ideal - floored, w);
+    }
+
+    std::sort(fractions.begin(), fractions.end(), [](const std::pair<double, int>& left, const std::pair<double, int>& right) -> bool {
+        if (left.first == right.first) {
+            return left.second < right.second;
+        } else {
+            return left.first > right.first;
+        }
+    });
+    for (int i = 0; allocated < leftover; ++allocated) {
+        ++(lengths[fractions[i].second]);
+        ++i;
+        if (i == num_workers) {
+            i = 0;
+        }
+    }
+
+    auto starts = sanisizer::create<std::vector<Task_> >(static_cast<std::size_t>(num_workers) + 1);
+    for (int w = 0; w < num_workers; ++w) {
+        starts[w + 1] = starts[w] + lengths[w];
+    }
+    return starts;
+}
+
+class CorePinner {
+public:
+    CorePinner(const int id) {
+#ifdef __linux__
+        if (id < 0 || id >= CPU_SETSIZE) {
+            return;
+        }
+        if (pthread_getaffinity_np(pthread_self(), sizeof(my_original), &my_original) != 0) {
+            return;
+        }
+        cpu_set_t target;
+        CPU_ZERO(&target);
+        CPU_SET(id, &target);
+        my_pinned = (pthread_setaffinity_np(pthread_self(), sizeof(target), &target) == 0);
+#else
+        (void)id;
+#endif
+    }
+
+    CorePinner(const CorePinner&) = delete;
+    CorePinner& operator=(const CorePinner&) = delete;
+
+    ~CorePinner() {
+#ifdef __linux__
+        // Restoring the original mask, which is mainly relevant for the calling thread.
+        if (my_pinned) {
+            pthread_setaffinity_np(pthread_self(), sizeof(my_original), &my_original);
+        }
+#endif
+    }
+
+private:
+#ifdef __linux__
+    cpu_set_t my_original;
+#endif
+    bool my_pinned = false;
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Get the capacities of the available CPU cores.
+ *
+ * On Linux, this considers all cores in the affinity mask of the calling process.
+ * The capacity of each core is taken from `/sys/devices/system/cpu/cpuN/cpu_capacity` (for core `N`) if available for all cores,
+ * otherwise from `/sys/devices/system/cpu/cpuN/cpufreq/cpuinfo_max_freq`;
+ * if neither is available, all cores are assumed to have equal capacity.
+ * On other platforms, an empty vector is returned.
+ *
+ * The results are computed on the first call and cached for all subsequent calls, to ensure that all calls to `parallelize_range_capacity()` use the same partitioning.
+ *
+ * @return Capacities of the available cores, sorted by decreasing capacity and then by increasing core ID.
+ */
+inline const std::vector<CoreCapacity>& get_core_capacities() {
+    static const std::vector<CoreCapacity> cores = internal::detect_core_capacities();
+    return cores;
+}
+
+/**
+ * @brief Parallelize a range of tasks across heterogeneous cores.
+ *
+ * This function is similar to the default `parallelize_range()` but sizes each worker's task range in proportion to the capacity of the core that it runs on.
+ * Worker `w` is assigned to the core at `cores[w % cores.size()]`; as `cores` is sorted by decreasing capacity by default, the lowest worker IDs are assigned to performance cores.
+ * Each worker receives at least one task, and the remaining tasks are distributed among workers in proportion to their capacities.
+ * The aim is to ensure that all workers finish at around the same time on CPUs with a mix of performance and efficiency cores,
+ * rather than having the performance cores sit idle while the efficiency cores finish their (equally sized) ranges.
+ *
+ * The partitioning of task ranges is deterministic for a given `num_workers`, `num_tasks` and `cores`, and thus for a given machine when the default `cores` are used.
+ * If all cores have the same capacity (or if `cores` is empty, e.g., on non-Linux platforms), this produces the same task ranges as the default `parallelize_range()`.
+ *
+ * If `pin = true`, each worker is pinned to its assigned core so that the capacity of the core that executes each task range is guaranteed to match its length.
+ * Pinning is not coordinated across concurrent calls - two simultaneous calls with 2 workers will both pin to the same two fastest cores and leave the others idle,
+ * which is worse than not pinning at all.
+ * Thus, pinning should only be enabled if the caller knows that it is the only user of the cores in `cores`, e.g., it is the sole parallel section in the application.
+ * Otherwise, the operating system's scheduler is responsible for placing workers on cores, in which case the task ranges are only approximately balanced.
+ * No pinning is performed for cores with negative IDs or on non-Linux platforms.
+ * The calling thread executes the task range for worker 0 and its affinity is restored on return.
+ *
+ * This can be used in place of the default scheme by defining `SUBPAR_CUSTOM_PARALLELIZE_RANGE` to `::subpar::parallelize_range_capacity`
+ * (and `SUBPAR_CUSTOM_PARALLELIZE_RANGE_NOTHROW` to `::subpar::parallelize_range_capacity<true>`) after including this header.
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Task_ Integer type for the number of tasks.
+ * @tparam Run_ Function that accepts three arguments, see `parallelize_range()` for details.
+ *
+ * @param num_workers Number of workers.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1.
+ * @param num_tasks Number of tasks.
+ * This should be a non-negative integer.
+ * @param run_task_range Function to iterate over a range of tasks within a worker, see `parallelize_range()` for details.
+ * @param cores Capacities of the cores on which to run the workers.
+ * @param pin Whether to pin each worker to its assigned core.
+ *
+ * @return The number of workers that were actually used, see `parallelize_range()` for details.
+ */
+template<bool nothrow_ = false, typename Task_, class Run_>
+int parallelize_range_capacity(int num_workers, const Task_ num_tasks, const Run_ run_task_range, const std::vector<CoreCapacity>& cores = get_core_capacities(), const bool pin = false) {
+    if (num_tasks <= 0) {
+        return 0;
+    }
+
+    if (num_workers <= 1 || num_tasks == 1) {
+        run_task_range(0, 0, num_tasks);
+        return 1;
+    }
+
+    static const std::vector<CoreCapacity> fallback{ CoreCapacity{ -1, 1 } };
+    const auto& used_cores = (cores.empty() ? fallback : cores);
+    const auto starts = internal::capacity_partition(num_workers, num_tasks, used_cores);
+    const auto num_cores = used_cores.size();
+
+    // Avoid instantiating a vector if it is known that the function can't throw.
+    auto errors = [&]{
+        if constexpr(nothrow_) {
+            return true;
+        } else {
+            return sanisizer::create<std::vector<std::exception_ptr> >(num_workers);
+        }
+    }();
+
+    auto run = [&](const int w) -> void {
+        internal::CorePinner pinner(pin ? used_cores[w % num_cores].id : -1);
+        const Task_ start = starts[w];
+        const Task_ length = starts[w + 1] - start;
+
+        if constexpr(nothrow_) {
+            run_task_range(w, start, length);
+        } else {
+            try {
+                run_task_range(w, start, length);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        }
+    };
+
+    // We run the first job on the current thread, to avoid having to spin up an unnecessary worker.
+    std::vector<std::thread> workers;
+    sanisizer::reserve(workers, num_workers - 1); // preallocate to ensure we don't get alloc errors during emplace_back().
+    for (int w = 1; w < num_workers; ++w) {
+        workers.emplace_back(run, w);
+    }
+
+    run(0);
+
+    for (auto& wrk : workers) {
+        wrk.join();
+    }
+
+    if constexpr(!nothrow_) {
+        for (const auto& e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    return num_workers;
+}
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef SUBPAR_CHUNK_HPP
+#define SUBPAR_CHUNK_HPP
+
+#include <vector>
+#include <utility>
+
+#include "sanisizer/sanisizer.hpp"
+#include "partition.hpp"
+#include "range.hpp"
+
+/**
+ * @file chunk.hpp
+ * @brief Parallelize across fixed logical chunks of tasks.
+ */
+
+namespace subpar {
+
+/**
+ * @brief Parallelize fixed logical chunks of tasks across multiple workers.
+ *
+ * The output of `parallelize_range()` is only reproducible for a given `num_workers`, as the task ranges depend on the number of workers.
+ * This is problematic for applications that need the same results on different machines, e.g., floating-point reductions where the order of operations affects the result.
+ * Instead, `parallelize_chunks()` splits the integer sequence `[0, num_tasks)` into `num_chunks` evenly-sized logical chunks, independently of the number of workers.
+ * The chunks are then distributed across workers via `parallelize_range()`, where each worker processes a contiguous sequence of chunks.
+ * If the results for each chunk are computed separately and combined in chunk order (see `reduce_chunks()`), they will be identical across any number of workers.
+ *
+ * The number of chunks should be chosen to be larger than the number of workers on any expected machine, to ensure that all workers are used.
+ * It should also be small enough that the per-chunk overhead of `run_chunk()` is negligible.
+ * The chunk boundaries are the same as the task ranges used by the default `parallelize_range()` with `num_chunks` workers.
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Task_ Integer type for the number of tasks.
+ * @tparam Run_ Function that accepts four arguments:
+ * - `w`, the identity of the worker executing this chunk.
+ *   This will be passed as an `int` in `[0, num_workers)`.
+ * - `c`, the index of the chunk.
+ *   This will be passed as an `int` in `[0, C)` where `C` is the return value of `parallelize_chunks()`.
+ * - `start`, the start index of the chunk's tasks.
+ *   This will be passed as a `Task_` in `[0, num_tasks)`.
+ * - `length`, the number of tasks in the chunk.
+ *   This will be passed as a positive `Task_`.
+ * .
+ * Any return value is ignored.
+ *
+ * @param num_workers Number of workers.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1.
+ * @param num_tasks Number of tasks.
+ * This should be a non-negative integer.
+ * @param num_chunks Number of logical chunks.
+ * This should be a positive integer and should be chosen independently of the hardware.
+ * Any zero or negative values are treated as 1.
+ * @param run_chunk Function to iterate over the tasks in a chunk.
+ * This will be called exactly once for each chunk.
+ * A worker may call this function multiple times, for consecutive chunks in increasing order of `c`.
+ * This function may throw an exception if `nothrow_ = false`.
+ *
+ * @return The number of chunks (`C`) that were actually used.
+ * This is equal to `sanitize_num_workers(num_chunks, num_tasks)`, i.e., it is independent of `num_workers`.
+ * The worker IDs passed to `run_chunk()` are guaranteed to lie in `[0, sanitize_num_workers(num_workers, C))`.
+ */
+template<bool nothrow_ = false, typename Task_, class Run_>
+int parallelize_chunks(const int num_workers, const Task_ num_tasks, int num_chunks, const Run_ run_chunk) {
+    if (num_tasks <= 0) {
+        return 0;
+    }
+
+    if (num_chunks <= 1) {
+        num_chunks = 1;
+    }
+
+    const internal::EvenPartition<Task_> chunks(num_chunks, num_tasks);
+
+    parallelize_range<nothrow_>(num_workers, num_chunks, [&](const int w, const int first, const int count) -> void {
+        for (int c = first, last = first + count; c < last; ++c) {
+            run_chunk(w, c, chunks.start(c), chunks.length(c));
+        }
+    });
+
+    return num_chunks;
+}
+
+/**
+ * @brief Reproducible parallel reduction over fixed logical chunks of tasks.
+ *
+ * This calls `parallelize_chunks()` to compute a result for each logical chunk, and then combines the results in increasing order of the chunk index.
+ * As neither the chunk boundaries nor the order of combination depend on the number of workers, the reduced value is identical for any `num_workers`,
+ * even if `merge()` is not associative (e.g., floating-point addition).
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Result_ Type of the result, which should be default-constructible and movable.
+ * This should not be `bool` as the per-chunk results are stored in a `std::vector`.
+ * @tparam Task_ Integer type for the number of tasks.
+ * @tparam Run_ Function that accepts three arguments:
+ * - `w`, the identity of the worker executing this chunk, see `parallelize_chunks()`.
+ * - `start`, the start index of the chunk's tasks.
+ * - `length`, the number of tasks in the chunk.
+ * .
+ * This should return a `Result_` for the chunk.
+ * @tparam Merge_ Function that accepts two `Result_` arguments - the current accumulated value and the result for the next chunk - and returns the new accumulated value.
+ *
+ * @param num_workers Number of workers, see `parallelize_chunks()`.
+ * @param num_tasks Number of tasks, see `parallelize_chunks()`.
+ * @param num_chunks Number of logical chunks, see `parallelize_chunks()`.
+ * @param initial Initial value for the reduction.
+ * @param run_chunk Function to compute the result for the tasks in a chunk.
+ * This function may throw an exception if `nothrow_ = false`.
+ * @param merge Function to combine the results.
+ * This is always called on the calling thread.
+ *
+ * @return The reduced value, i.e., `merge(...merge(merge(initial, R0), R1)..., R{C-1})` where `Ri` is the result of chunk `i`.
+ * This is equal to `initial` if `num_tasks = 0`.
+ */
+template<bool nothrow_ = false, typename Result_, typename Task_, class Run_, class Merge_>
+Result_ reduce_chunks(const int num_workers, const Task_ num_tasks, const int num_chunks, Result_ initial, const Run_ run_chunk, const Merge_ merge) {
+    auto results = sanisizer::create<std::vector<Result_> >(sanitize_num_workers(num_chunks, num_tasks));
+
+    parallelize_chunks<nothrow_>(num_workers, num_tasks, num_chunks, [&](const int w, const int c, const Task_ start, const Task_ length) -> void {
+        results[c] = run_chunk(w, start, length);
+    });
+
+    for (auto& res : results) {
+        initial = merge(std::move(initial), std::move(res));
+    }
+    return initial;
+}
+
+}
+
+#endif
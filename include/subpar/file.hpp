@@ -0,0 +1,245 @@
+#ifndef SUBPAR_FILE_HPP
+#define SUBPAR_FILE_HPP
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+#include "sanisizer/sanisizer.hpp"
+#include "partition.hpp"
+#include "range.hpp"
+
+/**
+ * @file file.hpp
+ * @brief Parallelize across records in a file.
+ */
+
+namespace subpar {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+class MappedFile {
+public:
+    MappedFile(const char* path) {
+#if defined(__unix__) || defined(__APPLE__)
+        my_fd = open(path, O_RDONLY);
+        if (my_fd < 0) {
+            throw std::runtime_error("failed to open file at '" + std::string(path) + "'");
+        }
+
+        struct stat info;
+        if (fstat(my_fd, &info) != 0) {
+            close(my_fd);
+            throw std::runtime_error("failed to determine the size of the file at '" + std::string(path) + "'");
+        }
+
+        // Non-regular files (e.g., FIFOs) can't be mapped, and files in procfs/sysfs are regular but report a size of zero,
+        // so in both cases we just read their contents into memory until EOF.
+        if (!S_ISREG(info.st_mode) || info.st_size == 0) {
+            char buffer[4096];
+            while (true) {
+                const auto nread = read(my_fd, buffer, sizeof(buffer));
+                if (nread < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    close(my_fd);
+                    throw std::runtime_error("failed to read the file at '" + std::string(path) + "'");
+                }
+                if (nread == 0) {
+                    break;
+                }
+                my_buffer.insert(my_buffer.end(), buffer, buffer + nread);
+            }
+            my_data = my_buffer.data();
+            my_size = my_buffer.size();
+            return;
+        }
+
+        my_size = info.st_size;
+
+        // mmap() fails for zero-length mappings, so we just leave it as NULL.
+        if (my_size) {
+            void* ptr = mmap(NULL, my_size, PROT_READ, MAP_PRIVATE, my_fd, 0);
+            if (ptr == MAP_FAILED) {
+                close(my_fd);
+                throw std::runtime_error("failed to memory-map the file at '" + std::string(path) + "'");
+            }
+            my_data = static_cast<const char*>(ptr);
+            my_mapped = true;
+        }
+#else
+        std::ifstream handle(path, std::ios::binary);
+        if (!handle) {
+            throw std::runtime_error("failed to open file at '" + std::string(path) + "'");
+        }
+        my_buffer.assign(std::istreambuf_iterator<char>(handle), std::istreambuf_iterator<char>());
+        my_data = my_buffer.data();
+        my_size = my_buffer.size();
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (my_mapped) {
+            munmap(const_cast<char*>(my_data), my_size);
+        }
+        close(my_fd);
+#endif
+    }
+
+private:
+    const char* my_data = NULL;
+    std::size_t my_size = 0;
+#if defined(__unix__) || defined(__APPLE__)
+    int my_fd;
+    bool my_mapped = false;
+#endif
+    std::vector<char> my_buffer;
+
+public:
+    const char* data() const {
+        return my_data;
+    }
+
+    std::size_t size() const {
+        return my_size;
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Parallelize across delimited records in a buffer.
+ *
+ * This function splits the buffer `[begin, end)` into byte ranges for parallel processing, ensuring that no record is split across multiple ranges.
+ * It starts by splitting the buffer into evenly-sized byte ranges as if the bytes were tasks in `parallelize_range()`.
+ * The end of each range is then moved forward to the first byte after the next `delimiter`, such that each range consists of complete records.
+ * Any ranges that become empty after this adjustment are discarded.
+ * The remaining ranges are passed to `run_records()` for parallel execution by different workers via `parallelize_range()`.
+ *
+ * The split points are deterministic for a given `num_workers` and buffer contents.
+ * Each worker processes no more than one byte range, and the worker IDs are guaranteed to lie in `[0, K)` where `K` is the return value of this function.
+ * If `SUBPAR_CUSTOM_PARALLELIZE_RANGE` is defined, the custom scheme will be used to distribute the byte ranges across workers;
+ * any worker that is assigned multiple consecutive byte ranges will receive a single call to `run_records()` spanning all of those ranges.
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Run_ Function that accepts three arguments:
+ * - `w`, the identity of the worker executing this byte range.
+ *   This will be passed as an `int` in `[0, num_workers)`.
+ * - `range_start`, a pointer to the start of the byte range.
+ *   This is guaranteed to be either `begin` or the byte after a `delimiter`.
+ * - `range_end`, a pointer to the end of the byte range.
+ *   This is guaranteed to be either `end` or the byte after a `delimiter`.
+ * .
+ * Any return value is ignored.
+ *
+ * @param num_workers Number of workers.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1.
+ * @param begin Pointer to the start of the buffer.
+ * @param end Pointer to the end of the buffer.
+ * @param run_records Function to process the records in a byte range.
+ * This will be called no more than once in each worker, with a non-empty byte range that does not overlap with the ranges of other workers.
+ * This function may throw an exception if `nothrow_ = false`.
+ * @param delimiter Character that marks the end of each record.
+ *
+ * @return The number of workers (`K`) that were actually used.
+ * This is zero if the buffer is empty.
+ */
+template<bool nothrow_ = false, class Run_>
+int parallelize_records(int num_workers, const char* begin, const char* end, const Run_ run_records, const char delimiter = '\n') {
+    const std::size_t size = end - begin;
+    if (size == 0) {
+        return 0;
+    }
+    if (num_workers <= 1) {
+        num_workers = 1;
+    }
+
+    const internal::EvenPartition<std::size_t> partition(num_workers, size);
+    std::vector<const char*> boundaries;
+    sanisizer::reserve(boundaries, static_cast<std::size_t>(num_workers) + 1);
+    boundaries.push_back(begin);
+
+    for (int w = 1; w < num_workers; ++w) {
+        // Searching from the last byte of the previous range, so that a range ending exactly on a delimiter is left as-is.
+        const char* candidate = begin + partition.start(w) - 1;
+        if (candidate < boundaries.back()) {
+            continue; // previous boundary was already pushed past this range by a long record.
+        }
+
+        const void* found = std::memchr(candidate, delimiter, end - candidate);
+        if (found == NULL) {
+            break;
+        }
+        const char* next = static_cast<const char*>(found) + 1;
+        if (next == end) {
+            break;
+        }
+        boundaries.push_back(next);
+    }
+    boundaries.push_back(end);
+
+    // Each logical byte range is treated as a task, so that custom schemes can assign multiple ranges to a single worker.
+    const int num_ranges = boundaries.size() - 1;
+    return parallelize_range<nothrow_>(num_ranges, num_ranges, [&](const int w, const int start, const int length) -> void {
+        run_records(w, boundaries[start], boundaries[start + length]);
+    });
+}
+
+/**
+ * @brief Parallelize across delimited records in a file.
+ *
+ * This function memory-maps the file at `path` and calls `parallelize_records()` on its contents,
+ * allowing applications to parse large text files (e.g., CSV, Matrix Market) in parallel without copying the file contents.
+ * On platforms without `mmap()`, the file contents are read into memory instead.
+ * The same applies to files that cannot be memory-mapped, i.e., non-regular files like FIFOs, as well as files that report a size of zero like those in `/proc` or `/sys`.
+ * The mapping is released when this function returns, so the pointers passed to `run_records()` should not be used after that point.
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Run_ Function that accepts three arguments, see `parallelize_records()` for details.
+ *
+ * @param num_workers Number of workers.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1.
+ * @param path Path to the file.
+ * An error is thrown if the file cannot be opened or mapped.
+ * @param run_records Function to process the records in a byte range, see `parallelize_records()` for details.
+ * @param delimiter Character that marks the end of each record.
+ *
+ * @return The number of workers that were actually used, see `parallelize_records()` for details.
+ */
+template<bool nothrow_ = false, class Run_>
+int parallelize_file(const int num_workers, const char* path, const Run_ run_records, const char delimiter = '\n') {
+    internal::MappedFile mapped(path);
+    const char* begin = mapped.data();
+    return parallelize_records<nothrow_>(num_workers, begin, begin + mapped.size(), run_records, delimiter);
+}
+
+}
+
+#endif
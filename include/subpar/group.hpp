@@ -0,0 +1,163 @@
+#ifndef SUBPAR_GROUP_HPP
+#define SUBPAR_GROUP_HPP
+
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+#include "sanisizer/sanisizer.hpp"
+#include "partition.hpp"
+#include "range.hpp"
+#include "simple.hpp"
+
+/**
+ * @file group.hpp
+ * @brief Parallelize multiple jobs on a shared set of workers.
+ */
+
+namespace subpar {
+
+/**
+ * @brief Group of independent jobs that share the same workers.
+ *
+ * Consider a series of independent `parallelize_range()` calls where each call has too few tasks to use all workers efficiently.
+ * Each call must wait for its slowest worker before the next call can start, leaving the other workers idle.
+ * Instead, `JobGroup` accepts multiple jobs - each of which is equivalent to a `parallelize_range()` call - and schedules all of their task ranges onto a shared set of workers.
+ * This fills the idle time between consecutive calls, as workers that finish early can immediately start on the task ranges of other jobs.
+ *
+ * Each job is partitioned into task ranges in the same manner as the default `parallelize_range()` for the same `num_workers` and `num_tasks`.
+ * Thus, each job's `run_task_range()` is called with the same combinations of `w`, `start` and `length` as in the corresponding `parallelize_range()` call,
+ * and per-worker buffers for each job can be allocated with `sanitize_num_workers()` as usual.
+ * However, the task ranges for a single job are not guaranteed to execute concurrently, e.g., if the workers are occupied by other jobs.
+ *
+ * Note that `w` is only unique within a job - task ranges from different jobs with the same `w` may be executed at the same time by different workers.
+ * Per-worker buffers indexed by `w` must not be shared across jobs in the same group,
+ * even though this is a common pattern for back-to-back `parallelize_range()` calls where each call waits for the previous one to finish.
+ * If buffers need to be shared across jobs, `run_task_range()` should accept an extra leading argument for the physical worker ID, see `add()` for details.
+ *
+ * The task ranges are distributed across `num_workers` workers via `parallelize_simple()`, so any `SUBPAR_CUSTOM_PARALLELIZE_SIMPLE` will be respected.
+ * Within each worker, task ranges are dynamically pulled from a shared list in order of job and then worker ID.
+ *
+ * @tparam Task_ Integer type for the number of tasks in each job.
+ */
+template<typename Task_>
+class JobGroup {
+public:
+    /**
+     * Add a job to the group.
+     *
+     * @tparam Run_ Function that accepts three arguments, see `parallelize_range()` for details.
+     * Alternatively, it may accept four arguments where the first argument is the physical worker ID as an `int`, followed by the usual three arguments.
+     * The physical worker ID identifies the worker that is executing the task range and is less than the `num_workers` used in `run()` (or 1, if `num_workers` is not positive).
+     * Unlike `w`, the physical worker ID is unique across all jobs at any given time, so it can be used to index into per-worker buffers that are shared between jobs.
+     * @param num_tasks Number of tasks for this job.
+     * This should be a non-negative integer.
+     * @param run_task_range Function to iterate over a range of tasks within a worker, see `parallelize_range()` for details.
+     * This is copied into the group, so any references captured by this function should remain valid until `run()` is called.
+     * It is always called as a `const` function, as it may be called concurrently by multiple workers.
+     * This function may throw an exception.
+     *
+     * @return Index of the job in the group.
+     */
+    template<class Run_>
+    std::size_t add(const Task_ num_tasks, Run_ run_task_range) {
+        // Wrapping the function so that it is always called as const, like in parallelize_range(); this prevents stateful functions from being mutated concurrently.
+        if constexpr(std::is_invocable<const Run_&, int, int, Task_, Task_>::value) {
+            my_jobs.emplace_back(num_tasks, [run = std::move(run_task_range)](const int physical, const int w, const Task_ start, const Task_ length) -> void {
+                run(physical, w, start, length);
+            });
+        } else {
+            my_jobs.emplace_back(num_tasks, [run = std::move(run_task_range)](const int, const int w, const Task_ start, const Task_ length) -> void {
+                run(w, start, length);
+            });
+        }
+        return my_jobs.size() - 1;
+    }
+
+    /**
+     * @return Number of jobs in the group.
+     */
+    std::size_t size() const {
+        return my_jobs.size();
+    }
+
+    /**
+     * Execute all jobs in the group and wait for them to finish.
+     * An exception thrown by one job does not prevent the execution of other jobs.
+     *
+     * @param num_workers Number of workers.
+     * This should be a positive integer.
+     * Any zero or negative values are treated as 1.
+     *
+     * @return Vector of length equal to the number of jobs.
+     * Each entry contains the exception thrown by the corresponding job, or is null if the job completed successfully.
+     * If multiple task ranges in the same job throw, the exception from the lowest worker ID is reported, as in `parallelize_range()`.
+     */
+    std::vector<std::exception_ptr> run(const int num_workers) const {
+        const auto num_jobs = my_jobs.size();
+        std::vector<std::size_t> offsets;
+        offsets.reserve(num_jobs + 1);
+        offsets.push_back(0);
+
+        struct Item {
+            std::size_t job;
+            int worker;
+            Task_ start;
+            Task_ length;
+        };
+        std::vector<Item> items;
+
+        for (std::size_t j = 0; j < num_jobs; ++j) {
+            const Task_ job_tasks = my_jobs[j].first;
+            int job_workers = sanitize_num_workers(num_workers, job_tasks);
+            if (job_workers > 0) {
+                const internal::EvenPartition<Task_> partition(job_workers, job_tasks);
+                for (int w = 0; w < job_workers; ++w) {
+                    items.push_back(Item{ j, w, partition.start(w), partition.length(w) });
+                }
+            }
+            offsets.push_back(items.size());
+        }
+
+        auto errors = sanisizer::create<std::vector<std::exception_ptr> >(items.size());
+        std::atomic<std::size_t> next(0);
+        const auto num_items = items.size();
+
+        parallelize_simple<true>(sanitize_num_workers(num_workers, num_items), [&](const int physical) -> void {
+            while (true) {
+                const std::size_t i = next.fetch_add(1);
+                if (i >= num_items) {
+                    break;
+                }
+
+                const auto& current = items[i];
+                try {
+                    my_jobs[current.job].second(physical, current.worker, current.start, current.length);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }
+        });
+
+        auto output = sanisizer::create<std::vector<std::exception_ptr> >(num_jobs);
+        for (std::size_t j = 0; j < num_jobs; ++j) {
+            for (auto i = offsets[j], end = offsets[j + 1]; i < end; ++i) {
+                if (errors[i]) {
+                    output[j] = errors[i];
+                    break;
+                }
+            }
+        }
+        return output;
+    }
+
+private:
+    std::vector<std::pair<Task_, std::function<void(int, int, Task_, Task_)> > > my_jobs;
+};
+
+}
+
+#endif
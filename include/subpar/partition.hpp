@@ -0,0 +1,55 @@
+#ifndef SUBPAR_PARTITION_HPP
+#define SUBPAR_PARTITION_HPP
+
+#include "sanisizer/sanisizer.hpp"
+
+/**
+ * @file partition.hpp
+ * @brief Partition a range of tasks into evenly-sized ranges.
+ */
+
+namespace subpar {
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// This mirrors the partitioning in the default parallelize_range(), so that alternative backends can produce the same task ranges for the same inputs.
+// It assumes that num_workers >= 1 and num_tasks >= 1; the constructor will reduce num_workers to num_tasks if the latter is smaller.
+template<typename Task_>
+class EvenPartition {
+public:
+    EvenPartition(int& num_workers, const Task_ num_tasks) {
+        // All workers with indices below 'remainder' get an extra task to fill up the remainder.
+        if (sanisizer::is_greater_than_or_equal(num_workers, num_tasks)) {
+            num_workers = num_tasks;
+        } else {
+            my_tasks_per_worker = num_tasks / num_workers;
+            my_remainder = num_tasks % num_workers;
+        }
+    }
+
+private:
+    Task_ my_tasks_per_worker = 1;
+    int my_remainder = 0;
+
+public:
+    Task_ start(const int w) const {
+        // Need to shift the start by the number of previous 'w' that added a remainder.
+        return w * my_tasks_per_worker + (w < my_remainder ? w : my_remainder);
+    }
+
+    Task_ length(const int w) const {
+        return my_tasks_per_worker + (w < my_remainder);
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+}
+
+#endif
@@ -0,0 +1,473 @@
+#ifndef SUBPAR_POOL_HPP
+#define SUBPAR_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+#include "sanisizer/sanisizer.hpp"
+#include "partition.hpp"
+
+/**
+ * @file pool.hpp
+ * @brief Fork-safe thread pool for parallelization.
+ */
+
+namespace subpar {
+
+/**
+ * @brief Priority class for calls to the thread pool.
+ *
+ * Task ranges from calls with a higher priority are always scheduled onto the pool's threads before any queued task ranges from calls with a lower priority.
+ * This allows latency-sensitive work to share the pool with background computations, see `parallelize_range_pool()` for details.
+ */
+enum class PoolPriority : unsigned char {
+    HIGH = 0,
+    NORMAL = 1,
+    LOW = 2
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline PoolPriority& current_pool_priority() {
+    thread_local PoolPriority priority = PoolPriority::NORMAL;
+    return priority;
+}
+
+class PoolPriorityRestorer {
+public:
+    PoolPriorityRestorer(const PoolPriority priority) : my_previous(current_pool_priority()) {
+        current_pool_priority() = priority;
+    }
+
+    PoolPriorityRestorer(const PoolPriorityRestorer&) = delete;
+    PoolPriorityRestorer& operator=(const PoolPriorityRestorer&) = delete;
+
+    ~PoolPriorityRestorer() {
+        current_pool_priority() = my_previous;
+    }
+
+private:
+    PoolPriority my_previous;
+};
+
+struct PoolBatch {
+    void (*run)(void*, int);
+    void* context;
+    int size;
+    int next;
+    int remaining;
+    PoolPriority priority;
+};
+
+class Pool {
+public:
+    Pool() = default;
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+private:
+    std::mutex my_mutex;
+    std::condition_variable my_work_cv, my_done_cv;
+    static constexpr int num_priorities = 3;
+    std::deque<PoolBatch*> my_queues[num_priorities]; // one queue per priority class, in decreasing order of priority.
+
+    // Each thread belongs to a priority class and only executes task ranges from batches with the same or higher priority.
+    // This ensures that threads of a higher-priority class are never tied up by lower-priority work.
+    int my_num_threads[num_priorities] = {};
+
+    // Assumes that the lock is already held.
+    PoolBatch* next_batch(const int level) const {
+        // Strict priority: lower-priority batches are only picked up when all higher-priority queues are empty.
+        for (int p = 0; p <= level; ++p) {
+            if (!my_queues[p].empty()) {
+                return my_queues[p].front();
+            }
+        }
+        return NULL;
+    }
+
+    // Assumes that the lock is already held.
+    int claim(PoolBatch& batch) {
+        const int index = batch.next;
+        ++batch.next;
+        if (batch.next == batch.size) {
+            auto& queue = my_queues[static_cast<int>(batch.priority)];
+            if (queue.front() == &batch) {
+                queue.pop_front();
+            } else {
+                queue.erase(std::find(queue.begin(), queue.end(), &batch));
+            }
+        }
+        return index;
+    }
+
+    void loop(const int level) {
+        std::unique_lock<std::mutex> lck(my_mutex);
+        while (true) {
+            PoolBatch* chosen = NULL;
+            my_work_cv.wait(lck, [&]() -> bool {
+                chosen = next_batch(level);
+                return chosen != NULL;
+            });
+
+            auto& batch = *chosen;
+            const int index = claim(batch);
+
+            lck.unlock();
+            {
+                // Nested calls inherit the priority of the batch.
+                PoolPriorityRestorer restorer(batch.priority);
+                batch.run(batch.context, index);
+            }
+            lck.lock();
+
+            // Once 'remaining' hits zero, the caller is free to destroy the batch, so we can't touch it after this point.
+            --batch.remaining;
+            if (batch.remaining == 0) {
+                my_done_cv.notify_all();
+            }
+        }
+    }
+
+public:
+    // Runs job(i) for all i in [0, num_jobs), where job(0) is always run on the calling thread.
+    // The job itself should not throw; exceptions should be handled by the caller's wrapper.
+    template<class Job_>
+    void execute(const int num_jobs, Job_& job, const PoolPriority priority) {
+        PoolPriorityRestorer restorer(priority);
+
+        PoolBatch batch;
+        batch.run = [](void* ptr, int i) -> void { (*static_cast<Job_*>(ptr))(i); };
+        batch.context = static_cast<void*>(&job);
+        batch.size = num_jobs;
+        batch.next = 1; // job 0 is reserved for the calling thread.
+        batch.remaining = num_jobs;
+        batch.priority = priority;
+
+        std::unique_lock<std::mutex> lck(my_mutex);
+        if (num_jobs > 1) {
+            // Threads are only spun up on demand, which also handles lazy reconstruction of the pool in a forked child.
+            // Each priority class gets enough of its own threads for its largest batch, so the total number of threads is bounded.
+            const int level = static_cast<int>(priority);
+            auto& num_threads = my_num_threads[level];
+            while (num_threads < num_jobs - 1) {
+                std::thread(&Pool::loop, this, level).detach();
+                ++num_threads;
+            }
+            my_queues[level].push_back(&batch);
+            my_work_cv.notify_all();
+        }
+        lck.unlock();
+
+        batch.run(batch.context, 0);
+
+        lck.lock();
+        --batch.remaining;
+        while (batch.remaining) {
+            // Helping out with our own batch ensures that we make progress even if all pool threads are busy, e.g., with concurrent or nested calls.
+            if (batch.next < batch.size) {
+                const int index = claim(batch);
+                lck.unlock();
+                batch.run(batch.context, index);
+                lck.lock();
+                --batch.remaining;
+            } else {
+                my_done_cv.wait(lck);
+            }
+        }
+    }
+};
+
+inline std::mutex& pool_registry_mutex() {
+    static std::mutex mut;
+    return mut;
+}
+
+inline Pool*& pool_registry() {
+    static Pool* ptr = NULL;
+    return ptr;
+}
+
+inline std::atomic<bool>& pool_backend_flag() {
+    static std::atomic<bool> flag(false);
+    return flag;
+}
+
+inline Pool& get_pool() {
+    static const bool registered = []() -> bool {
+#if defined(__unix__) || defined(__APPLE__)
+        // Only the forking thread survives in the child, so the pool's threads and any of its in-flight batches are meaningless there.
+        // We hold the registry lock across the fork so that the child never sees a half-constructed pool,
+        // and then the child discards the parent's pool so that a new one is lazily constructed on first use.
+        // The old pool is deliberately leaked as its mutexes/condition variables may be in an inconsistent state.
+        pthread_atfork(
+            []() -> void { pool_registry_mutex().lock(); },
+            []() -> void { pool_registry_mutex().unlock(); },
+            []() -> void {
+                pool_registry() = NULL;
+                pool_registry_mutex().unlock();
+            }
+        );
+#endif
+        return true;
+    }();
+    (void)registered;
+
+    // The pool is never destroyed as its threads (and any users of the pool) may outlive static destructors.
+    std::lock_guard<std::mutex> lck(pool_registry_mutex());
+    auto& ptr = pool_registry();
+    if (ptr == NULL) {
+        ptr = new Pool;
+    }
+    return *ptr;
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Set the default priority for calls to the thread pool.
+ *
+ * On construction, this sets the default priority for all calls to `parallelize_range_pool()` and `parallelize_simple_pool()` on the current thread.
+ * The previous default is restored on destruction.
+ * This is most useful when `parallelize_range_pool()` is used as `SUBPAR_CUSTOM_PARALLELIZE_RANGE`,
+ * as it allows an application to set the priority for all of the `parallelize_range()` calls in a library function without modifying the library itself.
+ *
+ * ```cpp
+ * {
+ *     subpar::PoolPriorityScope scope(subpar::PoolPriority::LOW);
+ *     some_library::recompute_everything(); // all parallelize_range() calls are now low priority.
+ * }
+ * ```
+ */
+class PoolPriorityScope {
+public:
+    /**
+     * @param priority Default priority for pool calls on the current thread.
+     */
+    PoolPriorityScope(const PoolPriority priority) : my_restorer(priority) {}
+
+private:
+    internal::PoolPriorityRestorer my_restorer;
+};
+
+/**
+ * @return Default priority for pool calls on the current thread.
+ * This is `PoolPriority::NORMAL` unless modified by a `PoolPriorityScope`, or if the current thread is executing a task range from a pool call with a different priority.
+ */
+inline PoolPriority get_pool_priority() {
+    return internal::current_pool_priority();
+}
+
+/**
+ * @brief Switch the default parallelization scheme to the fork-safe thread pool.
+ *
+ * If `use = true`, all subsequent calls to the default `parallelize_range()` and `parallelize_simple()` will be forwarded to `parallelize_range_pool()` and `parallelize_simple_pool()`, respectively.
+ * This is a run-time switch, so it affects all libraries that were compiled against this version of **subpar** without requiring them to be rebuilt.
+ * Applications should call this function once at start-up (e.g., before any forking) rather than toggling it while other threads are calling `parallelize_range()`.
+ *
+ * This has no effect on calls that are substituted at compile time via `SUBPAR_CUSTOM_PARALLELIZE_RANGE` or `SUBPAR_CUSTOM_PARALLELIZE_SIMPLE`.
+ * The switch is stored in a function-local static variable, which is shared across shared libraries on platforms with default ELF symbol visibility;
+ * libraries compiled with hidden visibility (or Windows DLLs) will have their own copy that must be set separately.
+ *
+ * @param use Whether to use the thread pool in the default scheme.
+ */
+inline void use_pool_backend(const bool use) {
+    internal::pool_backend_flag().store(use);
+}
+
+/**
+ * @return Whether the default `parallelize_range()` and `parallelize_simple()` are using the fork-safe thread pool, see `use_pool_backend()`.
+ */
+inline bool uses_pool_backend() {
+    return internal::pool_backend_flag().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Parallelize a range of tasks across multiple workers in a fork-safe thread pool.
+ *
+ * This function has the same semantics as the default `parallelize_range()` and will partition the tasks into exactly the same ranges for the same `num_workers` and `num_tasks`.
+ * However, instead of using OpenMP or spinning up new threads on every call, it executes the task ranges in a persistent process-wide pool of threads.
+ * The pool registers `pthread_atfork()` handlers so that it is safe to use in a process that is subsequently forked -
+ * the child process discards the parent's (now defunct) threads and lazily creates a new pool on its next call to `parallelize_range_pool()`.
+ * Thus, forked children retain full multi-threaded performance, unlike OpenMP where the child may deadlock or be forced to use serial code.
+ *
+ * To use this function in place of the default scheme, applications can call `use_pool_backend()` at run time:
+ *
+ * ```cpp
+ * #include "subpar/pool.hpp"
+ *
+ * int main() {
+ *     subpar::use_pool_backend(true); // all parallelize_range() calls in all libraries now use the pool.
+ *     // ...
+ * }
+ * ```
+ *
+ * Alternatively, the substitution can be performed at compile time by defining `SUBPAR_CUSTOM_PARALLELIZE_RANGE` before including the other **subpar** headers:
+ *
+ * ```cpp
+ * #include "subpar/pool.hpp"
+ * #define SUBPAR_CUSTOM_PARALLELIZE_RANGE ::subpar::parallelize_range_pool
+ * #define SUBPAR_CUSTOM_PARALLELIZE_RANGE_NOTHROW ::subpar::parallelize_range_pool<true>
+ * #include "subpar/subpar.hpp"
+ * ```
+ *
+ * In this case, the macros must be defined identically before every inclusion of the **subpar** headers in every translation unit of the application,
+ * including the translation units of any already-compiled libraries that use `parallelize_range()`, which will need to be rebuilt.
+ * Mixing translation units with and without the macros will give `parallelize_range()` different definitions, which is an ODR violation.
+ *
+ * The calling thread always executes the task range for worker 0, and will execute any other task ranges from the same call that have not yet been picked up by the pool.
+ * This ensures that nested or concurrent calls to `parallelize_range_pool()` will always make progress, even if all threads in the pool are occupied.
+ * The pool will grow as necessary to provide `num_workers - 1` threads for the largest request in each priority class, see below.
+ *
+ * `run_task_range()` should not call `fork()` itself, as the child process would wait indefinitely for the parent's pool threads to finish the other task ranges.
+ *
+ * Each call is assigned to a priority class, which is useful when latency-sensitive requests and background computations share the same process.
+ * The pool's threads will always pick up queued task ranges from `PoolPriority::HIGH` calls before those from `PoolPriority::NORMAL` calls, which in turn take precedence over `PoolPriority::LOW` calls.
+ * Task ranges that are already running are not pre-empted, so each priority class has its own set of threads in the pool, grown as necessary to provide `num_workers - 1` threads for the largest call in that class.
+ * A thread only executes task ranges from calls in its own class or in higher-priority classes,
+ * which ensures that high-priority calls are executed in parallel even if low-priority calls are occupying all of their own threads.
+ * The total number of threads in the pool is thus bounded by the number of priority classes multiplied by `num_workers - 1` for the largest call.
+ * Any calls to `parallelize_range_pool()` from within `run_task_range()` inherit the priority of the enclosing call by default.
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Task_ Integer type for the number of tasks.
+ * @tparam Run_ Function that accepts three arguments, see `parallelize_range()` for details.
+ *
+ * @param num_workers Number of workers.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1.
+ * @param num_tasks Number of tasks.
+ * This should be a non-negative integer.
+ * @param run_task_range Function to iterate over a range of tasks within a worker, see `parallelize_range()` for details.
+ * @param priority Priority class for this call.
+ * By default, this is taken from `get_pool_priority()`.
+ *
+ * @return The number of workers that were actually used, see `parallelize_range()` for details.
+ */
+template<bool nothrow_ = false, typename Task_, class Run_>
+int parallelize_range_pool(int num_workers, const Task_ num_tasks, const Run_ run_task_range, const PoolPriority priority = get_pool_priority()) {
+    if (num_tasks <= 0) {
+        return 0;
+    }
+
+    if (num_workers <= 1 || num_tasks == 1) {
+        run_task_range(0, 0, num_tasks);
+        return 1;
+    }
+
+    const internal::EvenPartition<Task_> partition(num_workers, num_tasks);
+
+    // Avoid instantiating a vector if it is known that the function can't throw.
+    auto errors = [&]{
+        if constexpr(nothrow_) {
+            return true;
+        } else {
+            return sanisizer::create<std::vector<std::exception_ptr> >(num_workers);
+        }
+    }();
+
+    auto job = [&](const int w) -> void {
+        const Task_ start = partition.start(w);
+        const Task_ length = partition.length(w);
+
+        if constexpr(nothrow_) {
+            run_task_range(w, start, length);
+        } else {
+            try {
+                run_task_range(w, start, length);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        }
+    };
+
+    internal::get_pool().execute(num_workers, job, priority);
+
+    if constexpr(!nothrow_) {
+        for (const auto& e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+
+    return num_workers;
+}
+
+/**
+ * @brief Parallelize individual tasks across workers in a fork-safe thread pool.
+ *
+ * This function has the same semantics as `parallelize_simple()` but uses the same fork-safe thread pool as `parallelize_range_pool()`.
+ * It can be used in place of the default scheme by defining `SUBPAR_CUSTOM_PARALLELIZE_SIMPLE` to `::subpar::parallelize_simple_pool` (and `SUBPAR_CUSTOM_PARALLELIZE_SIMPLE_NOTHROW` to `::subpar::parallelize_simple_pool<true>`).
+ *
+ * @tparam nothrow_ Whether the `Run_` function cannot throw an exception.
+ * @tparam Task_ Integer type for the number of tasks.
+ * @tparam Run_ Function that accepts `w`, the index of the task (and thus the worker ID) as a `Task_`.
+ * Any return value is ignored.
+ *
+ * @param num_tasks Number of tasks.
+ * This is also the number of workers as we assume a 1:1 mapping between tasks and workers.
+ * It should be non-negative.
+ * @param run_task Function to execute each task, see `parallelize_simple()` for details.
+ * @param priority Priority class for this call, see `parallelize_range_pool()` for details.
+ */
+template<bool nothrow_ = false, typename Task_, class Run_>
+void parallelize_simple_pool(const Task_ num_tasks, const Run_ run_task, const PoolPriority priority = get_pool_priority()) {
+    if (num_tasks <= 0) {
+        return;
+    } else if (num_tasks == 1) {
+        run_task(0);
+        return;
+    }
+
+    // Avoid instantiating a vector if it is known that the function can't throw.
+    auto errors = [&]{
+        if constexpr(nothrow_) {
+            return true;
+        } else {
+            return sanisizer::create<std::vector<std::exception_ptr> >(num_tasks);
+        }
+    }();
+
+    auto job = [&](const int w) -> void {
+        if constexpr(nothrow_) {
+            run_task(w);
+        } else {
+            try {
+                run_task(w);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        }
+    };
+
+    internal::get_pool().execute(sanisizer::cast<int>(num_tasks), job, priority);
+
+    if constexpr(!nothrow_) {
+        for (const auto& e : errors) {
+            if (e) {
+                std::rethrow_exception(e);
+            }
+        }
+    }
+}
+
+}
+
+#endif
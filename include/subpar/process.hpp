@@ -0,0 +1,361 @@
+#ifndef SUBPAR_PROCESS_HPP
+#define SUBPAR_PROCESS_HPP
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <type_traits>
+#include <cstddef>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#include <cstdio>
+#endif
+
+#include "sanisizer/sanisizer.hpp"
+#include "partition.hpp"
+
+/**
+ * @file process.hpp
+ * @brief Parallelize across a range of tasks with multiple processes.
+ */
+
+namespace subpar {
+
+/**
+ * @brief Buffer in anonymous shared memory.
+ *
+ * This is intended for collecting results from `parallelize_range_process()`, where each task range is executed in a forked child process.
+ * Writes by the child to a `SharedBuffer` that was allocated by the parent are visible to the parent after the child exits,
+ * whereas writes to any other memory are discarded with the child's address space.
+ * On platforms without `fork()`, this is just a heap-allocated array.
+ *
+ * @tparam Type_ Type of the buffer contents.
+ * This should be trivially copyable as the contents are shared across address spaces.
+ */
+template<typename Type_>
+class SharedBuffer {
+    static_assert(std::is_trivially_copyable<Type_>::value);
+
+public:
+    /**
+     * @param size Number of elements in the buffer.
+     * All elements are zero-initialized.
+     */
+    SharedBuffer(const std::size_t size) : my_size(size) {
+        if (size == 0) {
+            return;
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+        const auto nbytes = sanisizer::product<std::size_t>(size, sizeof(Type_));
+        void* ptr = mmap(NULL, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        my_data = static_cast<Type_*>(ptr); // mmap'd anonymous memory is already zero-filled.
+#else
+        my_data = new Type_[size]();
+#endif
+    }
+
+    /**
+     * @cond
+     */
+    SharedBuffer(const SharedBuffer&) = delete;
+    SharedBuffer& operator=(const SharedBuffer&) = delete;
+
+    SharedBuffer(SharedBuffer&& other) noexcept : my_data(other.my_data), my_size(other.my_size) {
+        other.my_data = NULL;
+        other.my_size = 0;
+    }
+
+    SharedBuffer& operator=(SharedBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            my_data = other.my_data;
+            my_size = other.my_size;
+            other.my_data = NULL;
+            other.my_size = 0;
+        }
+        return *this;
+    }
+
+    ~SharedBuffer() {
+        release();
+    }
+    /**
+     * @endcond
+     */
+
+private:
+    Type_* my_data = NULL;
+    std::size_t my_size;
+
+    void release() {
+        if (my_data == NULL) {
+            return;
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        munmap(static_cast<void*>(my_data), my_size * sizeof(Type_));
+#else
+        delete [] my_data;
+#endif
+        my_data = NULL;
+    }
+
+public:
+    /**
+     * @return Pointer to the start of the buffer.
+     */
+    Type_* data() {
+        return my_data;
+    }
+
+    /**
+     * @return Pointer to the start of the buffer.
+     */
+    const Type_* data() const {
+        return my_data;
+    }
+
+    /**
+     * @return Number of elements in the buffer.
+     */
+    std::size_t size() const {
+        return my_size;
+    }
+
+    /**
+     * @param i Index of the element of interest.
+     * @return Reference to the element.
+     */
+    Type_& operator[](const std::size_t i) {
+        return my_data[i];
+    }
+
+    /**
+     * @param i Index of the element of interest.
+     * @return Const reference to the element.
+     */
+    const Type_& operator[](const std::size_t i) const {
+        return my_data[i];
+    }
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// Returns an empty string on success, otherwise the message to be reported for worker 'w'.
+template<class Function_>
+std::string process_run(const int w, Function_ fun) {
+    std::string message;
+    try {
+        fun();
+    } catch (std::exception& e) {
+        message = e.what();
+        if (message.empty()) {
+            message = "unknown error in worker " + std::to_string(w);
+        }
+    } catch (...) {
+        message = "unknown error in worker " + std::to_string(w);
+    }
+    return message;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+inline void process_child(const int fd, const std::string& message) {
+    // Messages no larger than PIPE_BUF are written atomically and will never block on a full pipe,
+    // so the child can always exit regardless of when the parent gets around to reading it.
+    std::size_t remaining = (message.size() < PIPE_BUF ? message.size() : PIPE_BUF);
+    const char* ptr = message.data();
+    while (remaining) {
+        const auto written = write(fd, ptr, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        ptr += written;
+        remaining -= written;
+    }
+    close(fd);
+
+    // _exit() doesn't flush stdio buffers, so we need to do it ourselves to avoid losing the callback's output.
+    std::fflush(NULL);
+    _exit(message.empty() ? 0 : 1);
+}
+
+inline std::string process_collect(const int fd, const pid_t pid, const int w) {
+    std::string message;
+    char buffer[256];
+    while (true) {
+        const auto nread = read(fd, buffer, sizeof(buffer));
+        if (nread < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        } else if (nread == 0) {
+            break;
+        }
+        message.insert(message.end(), buffer, buffer + nread);
+    }
+    close(fd);
+
+    int status = 0;
+    while (waitpid(pid, &status, 0) < 0) {
+        if (errno != EINTR) {
+            return "failed to wait for the child process of worker " + std::to_string(w);
+        }
+    }
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+        return std::string();
+    } else if (message.empty()) {
+        return "child process of worker " + std::to_string(w) + " terminated abnormally";
+    } else {
+        return message;
+    }
+}
+#endif
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Parallelize a range of tasks across multiple processes.
+ *
+ * This function partitions the tasks into exactly the same ranges as the default `parallelize_range()` for the same `num_workers` and `num_tasks`.
+ * However, each task range is executed by `run_task_range()` in its own child process, created by `fork()`.
+ * This provides multi-core speed-ups for callbacks that cannot be executed on multiple threads, e.g., because they call into a single-threaded runtime like an embedded R interpreter.
+ * The calling process only waits for all children to finish and does not execute any task ranges itself.
+ *
+ * As each child has its own copy of the parent's address space, any results should be written to `SharedBuffer` instances that were allocated before calling `parallelize_range_process()`.
+ * Writes to other memory will not be visible in the parent.
+ * If `run_task_range()` throws an exception in a child, the exception's message is sent back to the parent and re-thrown as a `std::runtime_error`.
+ * (If multiple children throw, the message from the lowest worker ID is used.)
+ * A `std::runtime_error` is also thrown if a child terminates abnormally, e.g., due to a signal.
+ *
+ * The usual caveats for `fork()` apply here - in particular, if the parent is multi-threaded, `run_task_range()` should not depend on any locks held by the parent's other threads at the time of the call.
+ * Child processes exit with `_exit()` so no `atexit()` handlers or static destructors are run in the children.
+ * All C stdio streams (and thus `std::cout`, if it is synchronized with stdio) are flushed by each child before it exits, so any printed output from `run_task_range()` is not lost.
+ * The parent also flushes its stdio streams before forking so that its pending output is not duplicated by the children.
+ * If a child process could not be created, a `std::runtime_error` is thrown after all previously started children have finished, unless one of those children already failed.
+ * On platforms without `fork()`, all task ranges are executed serially in the calling process, and any exceptions are reported in the same manner as for the children.
+ *
+ * This function can be used as `SUBPAR_CUSTOM_PARALLELIZE_RANGE` if all callers of `parallelize_range()` use `SharedBuffer`s for their results.
+ * More typically, though, it is called directly by applications that know that their `run_task_range()` is not thread-safe.
+ *
+ * @tparam nothrow_ Ignored, as failures in the child processes must always be reported to the parent.
+ * This is only provided for consistency with the signature of `parallelize_range()`.
+ * @tparam Task_ Integer type for the number of tasks.
+ * @tparam Run_ Function that accepts three arguments, see `parallelize_range()` for details.
+ *
+ * @param num_workers Number of workers, i.e., child processes.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1.
+ * @param num_tasks Number of tasks.
+ * This should be a non-negative integer.
+ * @param run_task_range Function to iterate over a range of tasks within a worker, see `parallelize_range()` for details.
+ *
+ * @return The number of workers that were actually used, see `parallelize_range()` for details.
+ */
+template<bool nothrow_ = false, typename Task_, class Run_>
+int parallelize_range_process(int num_workers, const Task_ num_tasks, const Run_ run_task_range) {
+    if (num_tasks <= 0) {
+        return 0;
+    }
+
+    if (num_workers <= 1) {
+        // Still using a child process for consistency, so that writes to non-shared memory are never visible to the caller.
+        num_workers = 1;
+    }
+
+    const internal::EvenPartition<Task_> partition(num_workers, num_tasks);
+
+#if defined(__unix__) || defined(__APPLE__)
+    std::vector<pid_t> children;
+    std::vector<int> pipes;
+    sanisizer::reserve(children, num_workers);
+    sanisizer::reserve(pipes, num_workers);
+    std::string error, setup_error;
+
+    // Otherwise, any unflushed output in the parent would be printed again by each child.
+    std::fflush(NULL);
+
+    for (int w = 0; w < num_workers; ++w) {
+        int fds[2];
+        if (pipe(fds) != 0) {
+            setup_error = "failed to create a pipe for worker " + std::to_string(w);
+            break;
+        }
+
+        const pid_t pid = fork();
+        if (pid < 0) {
+            close(fds[0]);
+            close(fds[1]);
+            setup_error = "failed to fork a child process for worker " + std::to_string(w);
+            break;
+        }
+
+        if (pid == 0) {
+            close(fds[0]);
+            const auto message = internal::process_run(w, [&]() -> void { run_task_range(w, partition.start(w), partition.length(w)); });
+            internal::process_child(fds[1], message); // never returns.
+        }
+
+        close(fds[1]);
+        children.push_back(pid);
+        pipes.push_back(fds[0]);
+    }
+
+    // Always reaping all children, even if we failed to start some of them.
+    for (int c = 0, end = children.size(); c < end; ++c) {
+        auto message = internal::process_collect(pipes[c], children[c], c);
+        if (error.empty()) {
+            error.swap(message);
+        }
+    }
+
+    // Failures from the successfully started children take precedence, as they have lower worker IDs.
+    if (error.empty()) {
+        error.swap(setup_error);
+    }
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+
+#else
+    // Mimicking the behavior of the child processes, so that errors are reported in the same manner.
+    std::string error;
+    for (int w = 0; w < num_workers; ++w) {
+        auto message = internal::process_run(w, [&]() -> void { run_task_range(w, partition.start(w), partition.length(w)); });
+        if (error.empty()) {
+            error.swap(message);
+        }
+    }
+
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+#endif
+
+    return num_workers;
+}
+
+}
+
+#endif
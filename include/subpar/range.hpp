@@ -8,9 +8,11 @@
 #include <vector>
 #include <stdexcept>
 #include <thread>
+#include "pool.hpp"
 #endif
 
 #include "sanisizer/sanisizer.hpp"
+#include "partition.hpp"
 
 /**
  * @file range.hpp
@@ -67,6 +69,7 @@ int sanitize_num_workers(const int num_workers, const Task_ num_tasks) {
  * The `SUBPAR_USES_OPENMP_RANGE` macro will be defined as 1 if and only if OpenMP was used in the default scheme.
  * Users can define the `SUBPAR_NO_OPENMP_RANGE` macro to force `parallelize_range()` to use `<thread>` even if OpenMP is available.
  * This is occasionally useful when OpenMP cannot be used in some parts of the application, e.g., with POSIX forks.
+ * Alternatively, applications can call `use_pool_backend()` to switch the default scheme to a fork-safe thread pool at run time, see `parallelize_range_pool()` for details.
  *
  * Advanced users can substitute in their own parallelization scheme by defining `SUBPAR_CUSTOM_PARALLELIZE_RANGE` before including the **subpar** header.
  * For example, we might restrict the number of used workers to the number of physical cores available on the system,
@@ -134,6 +137,10 @@ int parallelize_range(int num_workers, const Task_ num_tasks, const Run_ run_tas
     }
 
 #else
+    if (uses_pool_backend()) {
+        return parallelize_range_pool<nothrow_>(num_workers, num_tasks, run_task_range);
+    }
+
     if (num_tasks <= 0) {
         return 0;
     }
@@ -143,24 +150,7 @@ int parallelize_range(int num_workers, const Task_ num_tasks, const Run_ run_tas
         return 1;
     }
 
-    // All workers with indices below 'remainder' get an extra task to fill up the remainder.
-    Task_ tasks_per_worker = 1;
-    int remainder = 0;
-    if (sanisizer::is_greater_than_or_equal(num_workers, num_tasks)) {
-        num_workers = num_tasks;
-    } else {
-        tasks_per_worker = num_tasks / num_workers;
-        remainder = num_tasks % num_workers;
-    }
-
-    const auto get_start = [&tasks_per_worker,&remainder](const int w) -> Task_ {
-        // Need to shift the start by the number of previous 'w' that added a remainder.
-        return w * tasks_per_worker + (w < remainder ? w : remainder);
-    };
-
-    const auto get_length = [&tasks_per_worker,&remainder](const int w) -> Task_ {
-        return tasks_per_worker + (w < remainder); 
-    };
+    const internal::EvenPartition<Task_> partition(num_workers, num_tasks);
 
     // Avoid instantiating a vector if it is known that the function can't throw.
     auto errors = [&]{
@@ -179,8 +169,8 @@ int parallelize_range(int num_workers, const Task_ num_tasks, const Run_ run_tas
     // so we need to do a loop here to ensure that each task range is executed.
     #pragma omp parallel for num_threads(num_workers)
     for (int w = 0; w < num_workers; ++w) {
-        const Task_ start = get_start(w);
-        const Task_ length = get_length(w);
+        const Task_ start = partition.start(w);
+        const Task_ length = partition.length(w);
 
         if constexpr(nothrow_) {
             run_task_range(w, start, length);
@@ -203,8 +193,8 @@ int parallelize_range(int num_workers, const Task_ num_tasks, const Run_ run_tas
     sanisizer::reserve(workers, num_workers - 1); // preallocate to ensure we don't get alloc errors during emplace_back().
 
     for (int w = 1; w < num_workers; ++w) {
-        const Task_ start = get_start(w);
-        const Task_ length = get_length(w);
+        const Task_ start = partition.start(w);
+        const Task_ length = partition.length(w);
 
         if constexpr(nothrow_) {
             workers.emplace_back(run_task_range, w, start, length);
@@ -220,8 +210,8 @@ int parallelize_range(int num_workers, const Task_ num_tasks, const Run_ run_tas
     }
 
     {
-        const Task_ start = get_start(0);
-        const Task_ length = get_length(0);
+        const Task_ start = partition.start(0);
+        const Task_ length = partition.length(0);
 
         if constexpr(nothrow_) {
             run_task_range(0, start, length);
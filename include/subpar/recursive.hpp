@@ -0,0 +1,394 @@
+#ifndef SUBPAR_RECURSIVE_HPP
+#define SUBPAR_RECURSIVE_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <limits>
+
+#include "sanisizer/sanisizer.hpp"
+
+/**
+ * @file recursive.hpp
+ * @brief Parallelize recursive divide-and-conquer algorithms.
+ */
+
+namespace subpar {
+
+class RecursiveContext;
+
+/**
+ * @cond
+ */
+namespace internal {
+
+// Using our own type erasure instead of std::function, so that move-only tasks can be spawned.
+struct RecursiveTask {
+    virtual ~RecursiveTask() = default;
+    virtual void operator()(RecursiveContext&) = 0;
+    std::atomic<int>* parent_pending;
+    int depth;
+};
+
+template<class Task_>
+struct RecursiveTaskImpl final : public RecursiveTask {
+    RecursiveTaskImpl(Task_ task) : task(std::move(task)) {}
+    Task_ task;
+    void operator()(RecursiveContext& context) override {
+        task(context);
+    }
+};
+
+struct RecursiveQueue {
+    std::mutex mutex;
+    std::deque<RecursiveTask*> tasks;
+};
+
+class RecursiveRuntime {
+public:
+    RecursiveRuntime(const int num_workers, const int max_depth, const bool nothrow) :
+        my_queues(sanisizer::create<std::vector<RecursiveQueue> >(num_workers)),
+        my_max_depth(max_depth),
+        my_nothrow(nothrow)
+    {}
+
+private:
+    std::vector<RecursiveQueue> my_queues;
+    int my_max_depth;
+    bool my_nothrow;
+
+    std::atomic<int> my_num_queued{0};
+    std::atomic<int> my_num_sleeping{0};
+    std::atomic<bool> my_finished{false};
+    std::mutex my_idle_mutex;
+    std::condition_variable my_idle_cv;
+
+    std::mutex my_error_mutex;
+    std::exception_ptr my_error;
+
+public:
+    int max_depth() const {
+        return my_max_depth;
+    }
+
+    bool nothrow() const {
+        return my_nothrow;
+    }
+
+    void push(const int w, std::unique_ptr<RecursiveTask> task) {
+        auto& queue = my_queues[w];
+        {
+            std::lock_guard<std::mutex> lck(queue.mutex);
+            queue.tasks.push_back(task.get());
+        }
+        task.release();
+
+        // Only bothering to take the lock if someone is waiting for work.
+        ++my_num_queued;
+        if (my_num_sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lck(my_idle_mutex);
+            my_idle_cv.notify_one();
+        }
+    }
+
+    // Each worker takes the most recent task from its own deque (depth-first, for locality),
+    // and steals the oldest task from other workers' deques (typically the largest remaining chunk of work).
+    std::unique_ptr<RecursiveTask> pop(const int w) {
+        {
+            auto& queue = my_queues[w];
+            std::lock_guard<std::mutex> lck(queue.mutex);
+            if (!queue.tasks.empty()) {
+                std::unique_ptr<RecursiveTask> output(queue.tasks.back());
+                queue.tasks.pop_back();
+                --my_num_queued;
+                return output;
+            }
+        }
+
+        const int num_workers = my_queues.size();
+        for (int i = 1; i < num_workers; ++i) {
+            auto& queue = my_queues[(w + i) % num_workers];
+            std::lock_guard<std::mutex> lck(queue.mutex);
+            if (!queue.tasks.empty()) {
+                std::unique_ptr<RecursiveTask> output(queue.tasks.front());
+                queue.tasks.pop_front();
+                --my_num_queued;
+                return output;
+            }
+        }
+
+        return std::unique_ptr<RecursiveTask>();
+    }
+
+    void execute(const int w, std::unique_ptr<RecursiveTask> task);
+
+    void loop(const int w) {
+        while (!my_finished.load()) {
+            auto task = pop(w);
+            if (task) {
+                execute(w, std::move(task));
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lck(my_idle_mutex);
+            ++my_num_sleeping;
+            my_idle_cv.wait(lck, [&]() -> bool { return my_num_queued.load() > 0 || my_finished.load(); });
+            --my_num_sleeping;
+        }
+    }
+
+    // Parks the calling worker until either 'pending' drops to zero or more work is queued.
+    void sleep(const std::atomic<int>& pending) {
+        std::unique_lock<std::mutex> lck(my_idle_mutex);
+        ++my_num_sleeping;
+        my_idle_cv.wait(lck, [&]() -> bool { return my_num_queued.load() > 0 || pending.load() == 0; });
+        --my_num_sleeping;
+    }
+
+    void complete(std::atomic<int>& pending) {
+        // The parent might be sleeping on its pending count, so we wake everyone as we don't know who the parent is.
+        // Once decremented to zero, the parent is free to return and destroy 'pending', so we can't touch it afterwards.
+        if (--pending == 0) {
+            std::lock_guard<std::mutex> lck(my_idle_mutex);
+            my_idle_cv.notify_all();
+        }
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lck(my_idle_mutex);
+        my_finished = true;
+        my_idle_cv.notify_all();
+    }
+
+    void record_error(std::exception_ptr error) {
+        std::lock_guard<std::mutex> lck(my_error_mutex);
+        if (!my_error) {
+            my_error = std::move(error);
+        }
+    }
+
+    const std::exception_ptr& error() const {
+        return my_error;
+    }
+};
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Context for a task in `parallelize_recursive()`.
+ *
+ * Each running task is given a `RecursiveContext`, which it can use to spawn child tasks and to wait for their completion.
+ * Instances of this class are only created by `parallelize_recursive()`.
+ */
+class RecursiveContext {
+public:
+    /**
+     * @cond
+     */
+    RecursiveContext(internal::RecursiveRuntime& runtime, const int worker, const int depth) : my_runtime(runtime), my_worker(worker), my_depth(depth) {}
+
+    RecursiveContext(const RecursiveContext&) = delete;
+    RecursiveContext& operator=(const RecursiveContext&) = delete;
+    /**
+     * @endcond
+     */
+
+private:
+    internal::RecursiveRuntime& my_runtime;
+    int my_worker;
+    int my_depth;
+    std::atomic<int> my_pending{0};
+
+public:
+    /**
+     * @return Identity of the worker executing the current task, in `[0, K)` where `K` is the return value of `parallelize_recursive()`.
+     * This may be used to index into per-worker buffers.
+     * Note that the worker ID may differ between a task and its children, as the latter may be stolen by other workers.
+     */
+    int worker() const {
+        return my_worker;
+    }
+
+    /**
+     * @return Depth of the current task in the task tree, where the root task has a depth of zero.
+     */
+    int depth() const {
+        return my_depth;
+    }
+
+    /**
+     * Spawn a child task that may be executed in parallel with the current task.
+     * If the child's depth would exceed the `max_depth` in `parallelize_recursive()`, the child is executed immediately on the current worker instead.
+     *
+     * Callers may also implement size-based cutoffs by calling their function directly (i.e., without `spawn()`) when the amount of work is below some threshold.
+     * This avoids the overhead of task creation for small problems that are not worth parallelizing.
+     *
+     * @tparam Task_ Function that accepts a `RecursiveContext&` for the child task.
+     * Any return value is ignored.
+     * This may be a move-only type, e.g., a lambda that captures a `std::unique_ptr`.
+     * @param task Function to execute as the child task.
+     * This may throw an exception, see `parallelize_recursive()` for details.
+     */
+    template<class Task_>
+    void spawn(Task_ task) {
+        const int child_depth = my_depth + 1;
+        if (child_depth > my_runtime.max_depth()) {
+            RecursiveContext child(my_runtime, my_worker, child_depth);
+            child.run(task);
+            return;
+        }
+
+        auto ptr = std::make_unique<internal::RecursiveTaskImpl<Task_> >(std::move(task));
+        ptr->parent_pending = &my_pending;
+        ptr->depth = child_depth;
+        ++my_pending;
+        my_runtime.push(my_worker, std::move(ptr));
+    }
+
+    /**
+     * Wait for all child tasks spawned by the current task to finish.
+     * While waiting, the current worker will execute other queued tasks (including its own children), so no worker is left idle.
+     * If there are no queued tasks (e.g., all children were stolen by other workers), the current worker sleeps until its children finish or more tasks are queued.
+     * This is automatically called when a task returns, so it is only necessary when the current task needs the children's results.
+     */
+    void wait() {
+        while (my_pending.load() > 0) {
+            auto task = my_runtime.pop(my_worker);
+            if (task) {
+                my_runtime.execute(my_worker, std::move(task));
+            } else {
+                my_runtime.sleep(my_pending);
+            }
+        }
+    }
+
+    /**
+     * @cond
+     */
+    template<class Task_>
+    void run(Task_& task) {
+        if (my_runtime.nothrow()) {
+            task(*this);
+        } else {
+            try {
+                task(*this);
+            } catch (...) {
+                my_runtime.record_error(std::current_exception());
+            }
+        }
+
+        // Children hold a pointer to our pending count, so we can't return until they're all done.
+        wait();
+    }
+    /**
+     * @endcond
+     */
+};
+
+/**
+ * @cond
+ */
+namespace internal {
+
+inline void RecursiveRuntime::execute(const int w, std::unique_ptr<RecursiveTask> task) {
+    auto parent_pending = task->parent_pending;
+    {
+        RecursiveContext context(*this, w, task->depth);
+        context.run(*task);
+    }
+    task.reset();
+    complete(*parent_pending);
+}
+
+}
+/**
+ * @endcond
+ */
+
+/**
+ * @brief Parallelize a recursive divide-and-conquer algorithm across workers.
+ *
+ * `parallelize_range()` requires the number of tasks to be known in advance, which is not possible for recursive algorithms like tree building or quicksort-style partitioning.
+ * Instead, `parallelize_recursive()` executes a root task that can spawn child tasks via `RecursiveContext::spawn()`, which may in turn spawn their own children, and so on.
+ * Each task can wait for its children to complete via `RecursiveContext::wait()`.
+ * Child tasks are distributed across workers via work-stealing - each worker maintains its own deque of spawned tasks and steals from other workers when its deque is empty.
+ * This avoids the oversubscription that would occur with nested calls to `parallelize_range()`.
+ *
+ * The root task is executed on the calling thread by worker 0, while `num_workers - 1` new threads are spun up for the other workers.
+ * Worker IDs are always in `[0, num_workers)` so that per-worker buffers can be safely used in each task.
+ * Spawning is skipped (i.e., children are executed immediately on the current worker) beyond `max_depth`, to avoid the overhead of creating many small tasks.
+ *
+ * ```cpp
+ * void sum(subpar::RecursiveContext& ctx, const double* ptr, size_t n, double& output) {
+ *     if (n < 10000) { // size-based cutoff.
+ *         output = std::accumulate(ptr, ptr + n, 0.0);
+ *         return;
+ *     }
+ *     double left, right;
+ *     ctx.spawn([&](subpar::RecursiveContext& child) -> void { sum(child, ptr, n / 2, left); });
+ *     sum(ctx, ptr + n / 2, n - n / 2, right);
+ *     ctx.wait();
+ *     output = left + right;
+ * }
+ * ```
+ *
+ * @tparam nothrow_ Whether the tasks cannot throw an exception.
+ * @tparam Root_ Function that accepts a `RecursiveContext&` for the root task.
+ * Any return value is ignored.
+ *
+ * @param num_workers Number of workers.
+ * This should be a positive integer.
+ * Any zero or negative values are treated as 1, in which case all tasks are executed serially on the calling thread.
+ * @param root Function to execute as the root task.
+ * If any task throws an exception and `nothrow_ = false`, the first exception is rethrown after all tasks have completed.
+ * If `nothrow_ = true`, exception handling is omitted and no task should throw.
+ * @param max_depth Maximum depth at which tasks are spawned for parallel execution.
+ * Children of tasks at this depth are executed immediately by the parent's worker.
+ *
+ * @return The number of workers that were used (`K`).
+ */
+template<bool nothrow_ = false, class Root_>
+int parallelize_recursive(int num_workers, Root_ root, const int max_depth = std::numeric_limits<int>::max()) {
+    if (num_workers <= 1) {
+        num_workers = 1;
+    }
+
+    // No point spawning anything if there's only one worker.
+    internal::RecursiveRuntime runtime(num_workers, (num_workers == 1 ? 0 : max_depth), nothrow_);
+
+    std::vector<std::thread> workers;
+    sanisizer::reserve(workers, num_workers - 1); // preallocate to ensure we don't get alloc errors during emplace_back().
+    for (int w = 1; w < num_workers; ++w) {
+        workers.emplace_back(&internal::RecursiveRuntime::loop, &runtime, w);
+    }
+
+    {
+        RecursiveContext context(runtime, 0, 0);
+        context.run(root);
+    }
+
+    runtime.finish();
+    for (auto& wrk : workers) {
+        wrk.join();
+    }
+
+    if constexpr(!nothrow_) {
+        if (runtime.error()) {
+            std::rethrow_exception(runtime.error());
+        }
+    }
+
+    return num_workers;
+}
+
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include <stdexcept>
 #include <thread>
 #include <type_traits>
+#include "pool.hpp"
 #endif
 
 /**
@@ -27,6 +28,7 @@ namespace subpar {
  * The `SUBPAR_USES_OPENMP_SIMPLE` macro will be defined as 1 if and only if OpenMP was used in the default scheme.
  * Users can define the `SUBPAR_NO_OPENMP_SIMPLE` macro to force `parallelize_simple()` to use `<thread>` even if OpenMP is available.
  * This is occasionally useful when OpenMP cannot be used in some parts of the application, e.g., with POSIX forks.
+ * Alternatively, applications can call `use_pool_backend()` to switch the default scheme to a fork-safe thread pool at run time, see `parallelize_simple_pool()` for details.
  *
  * Advanced users can substitute in their own parallelization scheme by defining `SUBPAR_CUSTOM_PARALLELIZE_SIMPLE` before including the **subpar** header.
  * This should be a function-like macro that accepts the same arguments as `parallelize_simple()` or the name of a function that accepts the same arguments as `parallelize_simple()`.
@@ -69,6 +71,11 @@ void parallelize_simple(const Task_ num_tasks, const Run_ run_task) {
     }
 
 #else
+    if (uses_pool_backend()) {
+        parallelize_simple_pool<nothrow_>(num_tasks, run_task);
+        return;
+    }
+
     if (num_tasks <= 0) {
         return;
     } else if (num_tasks == 1) {
@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include "subpar/capacity.hpp"
+#include "subpar/range.hpp"
+
+template<typename Task_>
+static std::vector<std::pair<Task_, Task_> > capacity_ranges(int num_workers, Task_ num_tasks, const std::vector<subpar::CoreCapacity>& cores) {
+    std::vector<std::pair<Task_, Task_> > ranges(std::max(num_workers, 1));
+    int used = subpar::parallelize_range_capacity(num_workers, num_tasks, [&](int w, Task_ start, Task_ len) -> void {
+        ranges[w].first = start;
+        ranges[w].second = len;
+    }, cores);
+    ranges.resize(used);
+    return ranges;
+}
+
+TEST(ParallelizeRangeCapacity, Detected) {
+    const auto& cores = subpar::get_core_capacities();
+#ifdef __linux__
+    EXPECT_FALSE(cores.empty());
+#endif
+    for (size_t i = 1; i < cores.size(); ++i) {
+        EXPECT_TRUE(cores[i - 1].capacity >= cores[i].capacity);
+        EXPECT_GT(cores[i].capacity, 0);
+    }
+
+    // Cached for consistency across calls.
+    EXPECT_EQ(&cores, &(subpar::get_core_capacities()));
+}
+
+TEST(ParallelizeRangeCapacity, SameAsDefault) {
+    std::vector<subpar::CoreCapacity> homogeneous{ { -1, 5 }, { -1, 5 }, { -1, 5 } };
+    std::vector<int> thread_counts { 0, 1, 2, 3, 6, 7, 11, 2000 };
+    std::vector<int> task_counts { 0, 1, 2, 10, 999, 1000 };
+
+    for (auto tn : thread_counts) {
+        for (auto nt : task_counts) {
+            std::vector<std::pair<int, int> > ref(std::max(tn, 1));
+            int ref_used = subpar::parallelize_range(tn, nt, [&](int w, int start, int len) -> void {
+                ref[w].first = start;
+                ref[w].second = len;
+            });
+            ref.resize(ref_used);
+            EXPECT_EQ(ref, capacity_ranges(tn, nt, homogeneous));
+            EXPECT_EQ(ref, capacity_ranges(tn, nt, std::vector<subpar::CoreCapacity>()));
+        }
+    }
+}
+
+TEST(ParallelizeRangeCapacity, Heterogeneous) {
+    std::vector<subpar::CoreCapacity> cores{ { -1, 2 }, { -1, 1 } };
+    {
+        auto ranges = capacity_ranges(2, 300, cores);
+        std::vector<std::pair<int, int> > expected{ { 0, 200 }, { 200, 100 } };
+        EXPECT_EQ(ranges, expected);
+    }
+
+    // Cycles through the cores if there are more workers.
+    {
+        auto ranges = capacity_ranges(4, 600, cores);
+        std::vector<std::pair<int, int> > expected{ { 0, 200 }, { 200, 100 }, { 300, 200 }, { 500, 100 } };
+        EXPECT_EQ(ranges, expected);
+    }
+
+    // Every worker gets at least one task.
+    {
+        auto ranges = capacity_ranges(3, 4, std::vector<subpar::CoreCapacity>{ { -1, 1000 }, { -1, 1 }, { -1, 1 } });
+        std::vector<std::pair<int, int> > expected{ { 0, 2 }, { 2, 1 }, { 3, 1 } };
+        EXPECT_EQ(ranges, expected);
+    }
+
+    // Works correctly with small integer types.
+    {
+        uint8_t njobs = 255;
+        auto ranges = capacity_ranges(3, njobs, std::vector<subpar::CoreCapacity>{ { -1, 3 }, { -1, 1.5 }, { -1, 1 } });
+        ASSERT_EQ(ranges.size(), 3);
+        EXPECT_EQ(ranges[0].first, 0);
+        EXPECT_EQ(ranges[1].first, ranges[0].second);
+        EXPECT_EQ(ranges[2].first, ranges[1].first + ranges[1].second);
+        EXPECT_EQ(ranges[2].first + ranges[2].second, njobs);
+        EXPECT_GT(ranges[0].second, ranges[1].second);
+        EXPECT_GT(ranges[1].second, ranges[2].second);
+    }
+}
+
+#ifdef __linux__
+TEST(ParallelizeRangeCapacity, Pinning) {
+    cpu_set_t before;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(before), &before), 0);
+
+    const auto& cores = subpar::get_core_capacities();
+    int nworkers = cores.size() + 1;
+    std::vector<int> observed(nworkers, -1);
+    subpar::parallelize_range_capacity(nworkers, 1000, [&](int w, int, int) -> void {
+        observed[w] = sched_getcpu();
+    }, cores, true);
+
+    for (int w = 0; w < nworkers; ++w) {
+        EXPECT_EQ(observed[w], cores[w % cores.size()].id);
+    }
+
+    cpu_set_t after;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(after), &after), 0);
+    EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+
+TEST(ParallelizeRangeCapacity, NoPinning) {
+    cpu_set_t before;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(before), &before), 0);
+
+    int nworkers = subpar::get_core_capacities().size() + 1;
+    std::vector<unsigned char> unchanged(nworkers, false);
+    subpar::parallelize_range_capacity(nworkers, 1000, [&](int w, int, int) -> void {
+        cpu_set_t current;
+        if (pthread_getaffinity_np(pthread_self(), sizeof(current), &current) == 0) {
+            unchanged[w] = CPU_EQUAL(&before, &current);
+        }
+    });
+
+    EXPECT_EQ(unchanged, std::vector<unsigned char>(nworkers, true));
+}
+#endif
+
+TEST(ParallelizeRangeCapacity, Errors) {
+    for (int error_thread = 0; error_thread < 2; ++error_thread) {
+        EXPECT_ANY_THROW({
+            try {
+                subpar::parallelize_range_capacity(255, 2, [&](int w, int, int) -> void {
+                    if (w == error_thread) {
+                        throw std::runtime_error("WHEE");
+                    }
+                });
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("WHEE") != std::string::npos);
+                throw;
+            }
+        });
+    }
+
+    std::vector<int> assignments(100, 255);
+    int used = subpar::parallelize_range_capacity<true>(5, assignments.size(), [&](int w, int start, int len) -> void {
+        std::fill_n(assignments.begin() + start, len, w);
+    });
+    EXPECT_EQ(used, 5);
+    EXPECT_EQ(std::count(assignments.begin(), assignments.end(), 255), 0);
+}
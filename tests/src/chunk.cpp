@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+
+#include "subpar/chunk.hpp"
+
+TEST(ParallelizeChunks, Basic) {
+    std::vector<std::pair<int, int> > ref;
+
+    for (int nw : { 0, 1, 2, 3, 7, 16, 64 }) {
+        std::vector<std::pair<int, int> > chunks(50);
+        std::vector<int> workers(50, -1);
+        int nchunks = subpar::parallelize_chunks(nw, 1000, 50, [&](int w, int c, int start, int len) -> void {
+            chunks[c].first = start;
+            chunks[c].second = len;
+            workers[c] = w;
+        });
+        EXPECT_EQ(nchunks, 50);
+
+        // Chunk boundaries are independent of the number of workers.
+        if (ref.empty()) {
+            ref = chunks;
+            EXPECT_EQ(ref.front().first, 0);
+            for (int c = 1; c < 50; ++c) {
+                EXPECT_EQ(ref[c].first, ref[c - 1].first + ref[c - 1].second);
+            }
+            EXPECT_EQ(ref.back().first + ref.back().second, 1000);
+        } else {
+            EXPECT_EQ(ref, chunks);
+        }
+
+        // Each worker processes a contiguous sequence of chunks.
+        EXPECT_TRUE(std::is_sorted(workers.begin(), workers.end()));
+        EXPECT_EQ(workers.front(), 0);
+        EXPECT_EQ(workers.back(), subpar::sanitize_num_workers(nw, nchunks) - 1);
+    }
+}
+
+TEST(ParallelizeChunks, Edges) {
+    EXPECT_EQ(subpar::parallelize_chunks(10, 0, 50, [&](int, int, int, int) -> void {}), 0);
+
+    EXPECT_EQ(subpar::parallelize_chunks(10, 5, 50, [&](int, int c, int, int len) -> void {
+        EXPECT_EQ(len, 1);
+        EXPECT_LT(c, 5);
+    }), 5);
+
+    EXPECT_EQ(subpar::parallelize_chunks(10, 100, 0, [&](int w, int c, int start, int len) -> void {
+        EXPECT_EQ(w, 0);
+        EXPECT_EQ(c, 0);
+        EXPECT_EQ(start, 0);
+        EXPECT_EQ(len, 100);
+    }), 1);
+
+    // Works correctly with small integer types.
+    uint8_t njobs = 255;
+    std::vector<int> covered(njobs);
+    EXPECT_EQ(subpar::parallelize_chunks(3, njobs, 20, [&](int, int, uint8_t start, uint8_t len) -> void {
+        std::fill_n(covered.begin() + start, len, 1);
+    }), 20);
+    EXPECT_EQ(covered, std::vector<int>(njobs, 1));
+}
+
+TEST(ReduceChunks, Reproducible) {
+    std::vector<double> values(12345);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = 1.0 / (i + 1) * (i % 2 ? -1e8 : 1e-8);
+    }
+
+    auto run = [&](int nw) -> double {
+        return subpar::reduce_chunks(
+            nw,
+            values.size(),
+            /* num_chunks = */ 97,
+            0.0,
+            [&](int, size_t start, size_t len) -> double {
+                double tmp = 0;
+                for (size_t i = start, end = start + len; i < end; ++i) {
+                    tmp += values[i];
+                }
+                return tmp;
+            },
+            [](double left, double right) -> double {
+                return left + right;
+            }
+        );
+    };
+
+    double ref = run(1);
+    for (int nw : { 2, 3, 5, 8, 16, 64, 200 }) {
+        EXPECT_EQ(ref, run(nw)); // exact equality is intended.
+    }
+
+    // Merging happens in chunk order.
+    auto order = subpar::reduce_chunks<true>(
+        4,
+        100,
+        10,
+        std::vector<int>(),
+        [&](int, int start, int) -> std::vector<int> { return std::vector<int>{ start }; },
+        [](std::vector<int> left, std::vector<int> right) -> std::vector<int> {
+            left.insert(left.end(), right.begin(), right.end());
+            return left;
+        }
+    );
+    std::vector<int> expected { 0, 10, 20, 30, 40, 50, 60, 70, 80, 90 };
+    EXPECT_EQ(order, expected);
+}
+
+TEST(ReduceChunks, Errors) {
+    EXPECT_ANY_THROW({
+        try {
+            subpar::reduce_chunks(
+                4,
+                100,
+                10,
+                0,
+                [&](int, int start, int) -> int {
+                    if (start == 50) {
+                        throw std::runtime_error("WHEE");
+                    }
+                    return start;
+                },
+                [](int left, int right) -> int { return left + right; }
+            );
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("WHEE") != std::string::npos);
+            throw;
+        }
+    });
+}
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+#include "subpar/file.hpp"
+
+static std::vector<std::string> split_records(int num_workers, const std::string& contents, char delimiter = '\n') {
+    std::vector<std::string> ranges(std::max(num_workers, 1));
+    int used = subpar::parallelize_records(num_workers, contents.data(), contents.data() + contents.size(), [&](int w, const char* start, const char* end) -> void {
+        ranges[w] = std::string(start, end);
+    }, delimiter);
+    ranges.resize(used);
+    return ranges;
+}
+
+static void check_records(const std::vector<std::string>& ranges, const std::string& contents, char delimiter = '\n') {
+    std::string combined;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        EXPECT_FALSE(ranges[i].empty());
+        if (i + 1 < ranges.size()) {
+            EXPECT_EQ(ranges[i].back(), delimiter);
+        }
+        combined += ranges[i];
+    }
+    EXPECT_EQ(combined, contents);
+}
+
+TEST(ParallelizeRecords, Basic) {
+    std::string contents;
+    for (int i = 0; i < 1000; ++i) {
+        contents += std::to_string(i * 12345) + "," + std::to_string(i) + "\n";
+    }
+
+    for (int nw : { 0, 1, 2, 3, 7, 16 }) {
+        auto ranges = split_records(nw, contents);
+        EXPECT_EQ(ranges.size(), std::max(nw, 1));
+        check_records(ranges, contents);
+
+        // Deterministic for the same number of workers.
+        EXPECT_EQ(ranges, split_records(nw, contents));
+    }
+
+    // Works without a trailing delimiter, or with a custom delimiter.
+    contents.pop_back();
+    check_records(split_records(5, contents), contents);
+
+    std::string semicolons = "a;bb;ccc;dddd;eeeee;ffffff;";
+    check_records(split_records(4, semicolons, ';'), semicolons, ';');
+}
+
+TEST(ParallelizeRecords, LongRecords) {
+    // A single long record swallows multiple byte ranges, which are then discarded.
+    std::string contents = "a\n" + std::string(1000, 'x') + "\nb\nc\n";
+    auto ranges = split_records(10, contents);
+    check_records(ranges, contents);
+    EXPECT_LT(ranges.size(), 10);
+    EXPECT_EQ(ranges.front(), "a\n" + std::string(1000, 'x') + "\n");
+
+    // No delimiters at all.
+    std::string single(500, 'y');
+    ranges = split_records(10, single);
+    ASSERT_EQ(ranges.size(), 1);
+    EXPECT_EQ(ranges.front(), single);
+
+    // More workers than bytes.
+    std::string tiny = "a\nb\n";
+    ranges = split_records(100, tiny);
+    std::vector<std::string> expected { "a\n", "b\n" };
+    EXPECT_EQ(ranges, expected);
+
+    EXPECT_EQ(split_records(10, std::string()).size(), 0);
+}
+
+TEST(ParallelizeRecords, Errors) {
+    std::string contents = "a\nb\nc\nd\n";
+    EXPECT_ANY_THROW({
+        try {
+            subpar::parallelize_records(4, contents.data(), contents.data() + contents.size(), [&](int w, const char*, const char*) -> void {
+                if (w == 2) {
+                    throw std::runtime_error("WHEE");
+                }
+            });
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("WHEE") != std::string::npos);
+            throw;
+        }
+    });
+}
+
+TEST(ParallelizeFile, Basic) {
+    std::string contents;
+    for (int i = 0; i < 5000; ++i) {
+        contents += std::to_string(i) + " " + std::to_string(i * i) + " 1.5\n";
+    }
+
+    const std::string path = testing::TempDir() + "subpar_file_test.txt";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    }
+
+    for (int nw : { 1, 4, 9 }) {
+        std::vector<std::string> ranges(nw);
+        int used = subpar::parallelize_file(nw, path.c_str(), [&](int w, const char* start, const char* end) -> void {
+            ranges[w] = std::string(start, end);
+        });
+        EXPECT_EQ(used, nw);
+        EXPECT_EQ(ranges, split_records(nw, contents));
+    }
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    }
+    EXPECT_EQ(subpar::parallelize_file(4, path.c_str(), [&](int, const char*, const char*) -> void {}), 0);
+
+    std::remove(path.c_str());
+    EXPECT_ANY_THROW(subpar::parallelize_file(4, path.c_str(), [&](int, const char*, const char*) -> void {}));
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(ParallelizeFile, Fifo) {
+    std::string contents;
+    for (int i = 0; i < 5000; ++i) {
+        contents += std::to_string(i) + "\n";
+    }
+
+    const std::string path = testing::TempDir() + "subpar_file_test.fifo";
+    std::remove(path.c_str());
+    ASSERT_EQ(mkfifo(path.c_str(), 0600), 0);
+
+    // Opening a FIFO for reading blocks until a writer shows up, so we need another thread to write to it.
+    std::thread writer([&]() -> void {
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+    });
+
+    std::vector<std::string> ranges(4);
+    int used = subpar::parallelize_file(4, path.c_str(), [&](int w, const char* start, const char* end) -> void {
+        ranges[w] = std::string(start, end);
+    });
+    writer.join();
+    std::remove(path.c_str());
+
+    EXPECT_EQ(used, 4);
+    EXPECT_EQ(ranges, split_records(4, contents));
+}
+#endif
+
+#ifdef __linux__
+TEST(ParallelizeFile, Procfs) {
+    // Files in /proc report a size of zero, but still have contents.
+    std::vector<std::string> ranges(4);
+    int used = subpar::parallelize_file(4, "/proc/self/status", [&](int w, const char* start, const char* end) -> void {
+        ranges[w] = std::string(start, end);
+    });
+    ASSERT_GT(used, 0);
+    ranges.resize(used);
+
+    std::string combined;
+    for (const auto& r : ranges) {
+        EXPECT_FALSE(r.empty());
+        EXPECT_EQ(r.back(), '\n');
+        combined += r;
+    }
+    EXPECT_EQ(combined.rfind("Name:", 0), 0);
+    EXPECT_NE(combined.find("\nThreads:"), std::string::npos);
+}
+#endif
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+
+#include "subpar/group.hpp"
+
+TEST(JobGroup, SameAsDefault) {
+    std::vector<int> task_counts { 0, 1, 5, 13, 100, 1000 };
+
+    for (int nw : { 0, 1, 3, 8 }) {
+        subpar::JobGroup<int> group;
+        std::vector<std::vector<std::pair<int, int> > > observed(task_counts.size());
+        for (size_t j = 0; j < task_counts.size(); ++j) {
+            auto& current = observed[j];
+            current.resize(std::max(nw, 1), std::make_pair(-1, -1));
+            EXPECT_EQ(group.add(task_counts[j], [&current](int w, int start, int len) -> void {
+                current[w].first = start;
+                current[w].second = len;
+            }), j);
+        }
+        EXPECT_EQ(group.size(), task_counts.size());
+
+        auto errors = group.run(nw);
+        ASSERT_EQ(errors.size(), task_counts.size());
+
+        for (size_t j = 0; j < task_counts.size(); ++j) {
+            EXPECT_FALSE(errors[j]);
+
+            std::vector<std::pair<int, int> > expected(std::max(nw, 1), std::make_pair(-1, -1));
+            subpar::parallelize_range(nw, task_counts[j], [&](int w, int start, int len) -> void {
+                expected[w].first = start;
+                expected[w].second = len;
+            });
+            EXPECT_EQ(observed[j], expected);
+        }
+    }
+}
+
+TEST(JobGroup, Empty) {
+    subpar::JobGroup<size_t> group;
+    EXPECT_TRUE(group.run(4).empty());
+}
+
+TEST(JobGroup, SmallIntegers) {
+    subpar::JobGroup<uint8_t> group;
+    std::vector<int> covered(255);
+    group.add(255, [&](int, uint8_t start, uint8_t len) -> void {
+        std::fill_n(covered.begin() + start, len, 1);
+    });
+    group.add(10, [&](int, uint8_t, uint8_t) -> void {});
+    auto errors = group.run(7);
+    EXPECT_FALSE(errors[0]);
+    EXPECT_FALSE(errors[1]);
+    EXPECT_EQ(covered, std::vector<int>(255, 1));
+}
+
+TEST(JobGroup, Errors) {
+    subpar::JobGroup<int> group;
+    std::atomic<int> completed(0);
+    group.add(10, [&](int w, int, int) -> void {
+        if (w == 1) {
+            throw std::runtime_error("WHEE");
+        }
+    });
+    group.add(10, [&](int, int, int len) -> void {
+        completed += len;
+    });
+    group.add(10, [&](int, int, int) -> void {
+        throw 1;
+    });
+
+    auto errors = group.run(4);
+    ASSERT_EQ(errors.size(), 3);
+
+    ASSERT_TRUE(errors[0]);
+    EXPECT_ANY_THROW({
+        try {
+            std::rethrow_exception(errors[0]);
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("WHEE") != std::string::npos);
+            throw;
+        }
+    });
+
+    // Other jobs are unaffected.
+    EXPECT_FALSE(errors[1]);
+    EXPECT_EQ(completed.load(), 10);
+
+    ASSERT_TRUE(errors[2]);
+    EXPECT_ANY_THROW(std::rethrow_exception(errors[2]));
+}
+
+TEST(JobGroup, PhysicalWorkers) {
+    constexpr int nw = 4;
+    std::vector<std::atomic<int> > in_use(nw);
+    std::atomic<int> clashes(0), bad_physical(0), total(0);
+
+    subpar::JobGroup<int> group;
+    for (int j = 0; j < 20; ++j) {
+        group.add(100, [&](int physical, int, int, int len) -> void {
+            if (physical < 0 || physical >= nw) {
+                ++bad_physical;
+                return;
+            }
+
+            // Checking that the same physical worker is never used by two task ranges at once.
+            if (in_use[physical].fetch_add(1) != 0) {
+                ++clashes;
+            }
+            total += len;
+            --in_use[physical];
+        });
+    }
+
+    // Mixing in a job with the usual three-argument signature.
+    std::vector<std::pair<int, int> > observed(nw);
+    group.add(10, [&](int w, int start, int len) -> void {
+        observed[w] = std::make_pair(start, len);
+    });
+
+    auto errors = group.run(nw);
+    for (const auto& e : errors) {
+        EXPECT_FALSE(e);
+    }
+    EXPECT_EQ(bad_physical.load(), 0);
+    EXPECT_EQ(clashes.load(), 0);
+    EXPECT_EQ(total.load(), 2000);
+
+    std::vector<std::pair<int, int> > expected { { 0, 3 }, { 3, 3 }, { 6, 2 }, { 8, 2 } };
+    EXPECT_EQ(observed, expected);
+}
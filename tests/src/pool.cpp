@@ -0,0 +1,335 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "subpar/pool.hpp"
+#include "subpar/range.hpp"
+#include "subpar/simple.hpp"
+
+static bool check_pool_sum(int num_workers, int num_tasks) {
+    std::vector<int> values(num_tasks);
+    for (int t = 0; t < num_tasks; ++t) {
+        values[t] = t;
+    }
+
+    std::vector<long long> partials(num_workers);
+    int used = subpar::parallelize_range_pool(num_workers, num_tasks, [&](int w, int start, int length) -> void {
+        long long tmp = 0;
+        for (int t = start, end = start + length; t < end; ++t) {
+            tmp += values[t];
+        }
+        partials[w] = tmp;
+    });
+
+    long long total = 0;
+    for (int u = 0; u < used; ++u) {
+        total += partials[u];
+    }
+    return total == static_cast<long long>(num_tasks) * (num_tasks - 1) / 2;
+}
+
+TEST(ParallelizeRangePool, SameAsDefault) {
+    std::vector<int> thread_counts { 1, 2, 3, 6, 7, 11, 20 };
+
+    for (auto tn : thread_counts) {
+        std::vector<std::pair<int, int> > ref(tn), obs(tn);
+        int ref_used = subpar::parallelize_range(tn, 1000, [&](int w, int start, int len) -> void {
+            ref[w].first = start;
+            ref[w].second = len;
+        });
+        int obs_used = subpar::parallelize_range_pool(tn, 1000, [&](int w, int start, int len) -> void {
+            obs[w].first = start;
+            obs[w].second = len;
+        });
+        EXPECT_EQ(ref_used, obs_used);
+        EXPECT_EQ(ref, obs);
+    }
+
+    EXPECT_EQ(subpar::parallelize_range_pool(10, 0, [&](int, int, int) -> void {}), 0);
+}
+
+TEST(ParallelizeRangePool, Concurrent) {
+    // Hammering the pool from multiple threads, with nested calls as well.
+    std::vector<std::thread> callers;
+    std::atomic<int> failures(0);
+    for (int c = 0; c < 4; ++c) {
+        callers.emplace_back([&]() -> void {
+            for (int i = 0; i < 50; ++i) {
+                if (!check_pool_sum(4, 1000)) {
+                    ++failures;
+                }
+                subpar::parallelize_range_pool(3, 3, [&](int, int, int) -> void {
+                    if (!check_pool_sum(3, 100)) {
+                        ++failures;
+                    }
+                });
+            }
+        });
+    }
+    for (auto& c : callers) {
+        c.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+}
+
+TEST(ParallelizeRangePool, Errors) {
+    for (int error_thread = 0; error_thread < 2; ++error_thread) {
+        EXPECT_ANY_THROW({
+            try {
+                subpar::parallelize_range_pool(255, 2, [&](int w, int, int) -> void {
+                    if (w == error_thread) {
+                        throw std::runtime_error("WHEE");
+                    }
+                });
+            } catch (std::exception& e) {
+                EXPECT_TRUE(std::string(e.what()).find("WHEE") != std::string::npos);
+                throw;
+            }
+        });
+    }
+
+    // Pool is still usable after an error.
+    EXPECT_TRUE(check_pool_sum(5, 1000));
+}
+
+TEST(ParallelizeRangePool, Nothrow) {
+    std::vector<int> assignments(1000, 255);
+    int used = subpar::parallelize_range_pool<true>(5, assignments.size(), [&](int w, int start, int len) -> void {
+        std::fill_n(assignments.begin() + start, len, w);
+    });
+    EXPECT_EQ(used, 5);
+    EXPECT_EQ(std::count(assignments.begin(), assignments.end(), 255), 0);
+}
+
+TEST(ParallelizeSimplePool, Basic) {
+    std::vector<int> thread_counts { 0, 1, 3, 6, 7, 9, 11 };
+    for (auto tn : thread_counts) {
+        std::vector<int> assignments(tn, 255);
+        subpar::parallelize_simple_pool(tn, [&](int t) -> void { assignments[t] = 1; });
+        EXPECT_EQ(assignments, std::vector<int>(tn, 1));
+
+        std::vector<int> assignments2(tn, 255);
+        subpar::parallelize_simple_pool<true>(tn, [&](int t) -> void { assignments2[t] = 1; });
+        EXPECT_EQ(assignments2, std::vector<int>(tn, 1));
+    }
+
+    EXPECT_ANY_THROW(subpar::parallelize_simple_pool(2, [&](int) -> void { throw 1; }));
+}
+
+TEST(ParallelizeRangePool, PriorityScope) {
+    EXPECT_EQ(subpar::get_pool_priority(), subpar::PoolPriority::NORMAL);
+    {
+        subpar::PoolPriorityScope scope(subpar::PoolPriority::LOW);
+        EXPECT_EQ(subpar::get_pool_priority(), subpar::PoolPriority::LOW);
+
+        // Nested calls inherit the priority of the enclosing call, on all threads.
+        std::vector<int> observed(4);
+        subpar::parallelize_range_pool(4, 4, [&](int w, int, int) -> void {
+            observed[w] = static_cast<int>(subpar::get_pool_priority());
+        }, subpar::PoolPriority::HIGH);
+        EXPECT_EQ(observed, std::vector<int>(4, static_cast<int>(subpar::PoolPriority::HIGH)));
+
+        subpar::parallelize_simple_pool(4, [&](int w) -> void {
+            observed[w] = static_cast<int>(subpar::get_pool_priority());
+        });
+        EXPECT_EQ(observed, std::vector<int>(4, static_cast<int>(subpar::PoolPriority::LOW)));
+
+        EXPECT_EQ(subpar::get_pool_priority(), subpar::PoolPriority::LOW);
+    }
+    EXPECT_EQ(subpar::get_pool_priority(), subpar::PoolPriority::NORMAL);
+}
+
+TEST(ParallelizeRangePool, Backend) {
+    EXPECT_FALSE(subpar::uses_pool_backend());
+    subpar::use_pool_backend(true);
+    EXPECT_TRUE(subpar::uses_pool_backend());
+
+    // All task ranges inherit the caller's priority if and only if they're run in the pool.
+    {
+        subpar::PoolPriorityScope scope(subpar::PoolPriority::LOW);
+        std::vector<int> observed(4);
+        EXPECT_EQ(subpar::parallelize_range(4, 100, [&](int w, int, int) -> void {
+            observed[w] = static_cast<int>(subpar::get_pool_priority());
+        }), 4);
+        EXPECT_EQ(observed, std::vector<int>(4, static_cast<int>(subpar::PoolPriority::LOW)));
+
+        std::vector<int> observed2(5);
+        subpar::parallelize_simple<true>(5, [&](int w) -> void {
+            observed2[w] = static_cast<int>(subpar::get_pool_priority());
+        });
+        EXPECT_EQ(observed2, std::vector<int>(5, static_cast<int>(subpar::PoolPriority::LOW)));
+    }
+
+    EXPECT_TRUE(check_pool_sum(7, 1000));
+    EXPECT_ANY_THROW(subpar::parallelize_range(3, 10, [&](int, int, int) -> void { throw 1; }));
+
+    subpar::use_pool_backend(false);
+    EXPECT_FALSE(subpar::uses_pool_backend());
+}
+
+// Waiting with a timeout so that failures don't hang the test suite.
+template<class Condition_>
+static void wait_until(Condition_ condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+TEST(ParallelizeRangePool, PrioritySaturated) {
+    // Saturating the pool with long-running low-priority task ranges.
+    constexpr int num_low = 64;
+    std::atomic<int> low_started(0);
+    std::atomic<bool> high_done(false);
+    std::thread background([&]() -> void {
+        subpar::parallelize_range_pool(num_low, num_low, [&](int, int, int) -> void {
+            ++low_started;
+            while (!high_done.load()) { // no timeout needed, as the high-priority call below always finishes.
+                std::this_thread::yield();
+            }
+        }, subpar::PoolPriority::LOW);
+    });
+    wait_until([&]() -> bool { return low_started.load() == num_low; });
+    EXPECT_EQ(low_started.load(), num_low);
+
+    // Each high-priority task range waits for all others to start, so they must be executed on different threads.
+    constexpr int num_high = 4;
+    std::atomic<int> high_started(0);
+    std::vector<std::thread::id> ids(num_high);
+    subpar::parallelize_range_pool(num_high, num_high, [&](int w, int, int) -> void {
+        ids[w] = std::this_thread::get_id();
+        ++high_started;
+        wait_until([&]() -> bool { return high_started.load() == num_high; });
+    }, subpar::PoolPriority::HIGH);
+    high_done = true;
+    background.join();
+
+    std::sort(ids.begin(), ids.end());
+    EXPECT_EQ(std::unique(ids.begin(), ids.end()) - ids.begin(), num_high);
+}
+
+#ifdef __linux__
+static int count_threads() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("Threads:", 0) == 0) {
+            return std::stoi(line.substr(8));
+        }
+    }
+    return -1;
+}
+
+TEST(ParallelizeRangePool, PriorityThreadCount) {
+    constexpr int num_workers = 8;
+    auto saturate = [&]() -> void {
+        // Keeping a backlog of low-priority calls while making lots of high-priority calls.
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> background;
+        for (int b = 0; b < 4; ++b) {
+            background.emplace_back([&]() -> void {
+                while (!stop.load()) {
+                    subpar::parallelize_range_pool(num_workers, num_workers, [&](int, int, int) -> void {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }, subpar::PoolPriority::LOW);
+                }
+            });
+        }
+
+        for (int i = 0; i < 30; ++i) {
+            subpar::parallelize_range_pool(num_workers, num_workers, [&](int, int, int) -> void {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }, subpar::PoolPriority::HIGH);
+        }
+
+        stop = true;
+        for (auto& b : background) {
+            b.join();
+        }
+    };
+
+    // At most, we add one set of threads for each of the HIGH and LOW classes.
+    const int before = count_threads();
+    ASSERT_GT(before, 0);
+    saturate();
+    const int after = count_threads();
+    EXPECT_LE(after - before, 2 * (num_workers - 1));
+
+    // Repeated use does not cause the pool to grow any further.
+    saturate();
+    EXPECT_EQ(count_threads(), after);
+}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+static int fork_and_check(int num_workers, int depth) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Killing the child if it deadlocks, so that the parent sees a failure instead of hanging.
+        alarm(30);
+        bool okay = check_pool_sum(num_workers, 10000);
+        if (okay && depth > 0) {
+            okay = (fork_and_check(num_workers, depth - 1) == 0);
+        }
+        _exit(okay ? 0 : 1);
+    }
+
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid) {
+        return -1;
+    }
+    if (!WIFEXITED(status)) {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+TEST(ParallelizeRangePool, ForkStress) {
+    // Making sure the pool is live in the parent before forking.
+    EXPECT_TRUE(check_pool_sum(8, 10000));
+
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(fork_and_check(8, 2), 0);
+    }
+
+    // Forking while other threads are actively using the pool.
+    std::atomic<bool> stop(false);
+    std::atomic<int> failures(0);
+    std::vector<std::thread> background;
+    for (int b = 0; b < 3; ++b) {
+        background.emplace_back([&]() -> void {
+            while (!stop.load()) {
+                if (!check_pool_sum(4, 5000)) {
+                    ++failures;
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < 50; ++i) {
+        EXPECT_EQ(fork_and_check(6, 1), 0);
+    }
+
+    stop = true;
+    for (auto& b : background) {
+        b.join();
+    }
+    EXPECT_EQ(failures.load(), 0);
+
+    // Parent's pool is still fine.
+    EXPECT_TRUE(check_pool_sum(8, 10000));
+}
+#endif
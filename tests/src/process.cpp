@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <signal.h>
+#include <sys/resource.h>
+#endif
+
+#include "subpar/process.hpp"
+#include "subpar/range.hpp"
+
+TEST(ParallelizeRangeProcess, SharedBuffer) {
+    subpar::SharedBuffer<double> buffer(100);
+    EXPECT_EQ(buffer.size(), 100);
+    for (std::size_t i = 0; i < buffer.size(); ++i) {
+        EXPECT_EQ(buffer[i], 0);
+    }
+
+    buffer[5] = 10;
+    subpar::SharedBuffer<double> moved(std::move(buffer));
+    EXPECT_EQ(moved[5], 10);
+    EXPECT_EQ(moved.data()[5], 10);
+
+    subpar::SharedBuffer<int> empty(0);
+    EXPECT_EQ(empty.size(), 0);
+}
+
+TEST(ParallelizeRangeProcess, SameAsDefault) {
+    std::vector<int> thread_counts { 0, 1, 2, 3, 6, 7, 11 };
+
+    for (auto tn : thread_counts) {
+        std::vector<int> ref(1000, -1);
+        int ref_used = subpar::parallelize_range(tn, 1000, [&](int w, int start, int len) -> void {
+            std::fill_n(ref.begin() + start, len, w);
+        });
+
+        subpar::SharedBuffer<int> obs(1000);
+        int obs_used = subpar::parallelize_range_process(tn, 1000, [&](int w, int start, int len) -> void {
+            std::fill_n(obs.data() + start, len, w);
+        });
+
+        EXPECT_EQ(ref_used, obs_used);
+        EXPECT_EQ(ref, std::vector<int>(obs.data(), obs.data() + obs.size()));
+    }
+
+    EXPECT_EQ(subpar::parallelize_range_process(10, 0, [&](int, int, int) -> void {}), 0);
+}
+
+TEST(ParallelizeRangeProcess, Isolated) {
+    std::vector<int> unshared(100, -1);
+    subpar::parallelize_range_process(4, 100, [&](int w, int start, int len) -> void {
+        std::fill_n(unshared.begin() + start, len, w);
+    });
+
+#if defined(__unix__) || defined(__APPLE__)
+    EXPECT_EQ(unshared, std::vector<int>(100, -1));
+#endif
+}
+
+TEST(ParallelizeRangeProcess, Errors) {
+    for (int error_worker = 0; error_worker < 3; ++error_worker) {
+        EXPECT_ANY_THROW({
+            try {
+                subpar::parallelize_range_process(3, 10, [&](int w, int, int) -> void {
+                    if (w == error_worker) {
+                        throw std::runtime_error("WHEE" + std::to_string(w));
+                    }
+                });
+            } catch (std::exception& e) {
+                EXPECT_EQ(std::string(e.what()), "WHEE" + std::to_string(error_worker));
+                throw;
+            }
+        });
+    }
+
+    EXPECT_ANY_THROW({
+        try {
+            subpar::parallelize_range_process(2, 10, [&](int, int, int) -> void {
+                throw 1;
+            });
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("unknown error in worker 0") != std::string::npos);
+            throw;
+        }
+    });
+
+#if defined(__unix__) || defined(__APPLE__)
+    EXPECT_ANY_THROW({
+        try {
+            subpar::parallelize_range_process(2, 10, [&](int w, int, int) -> void {
+                if (w == 1) {
+                    raise(SIGKILL);
+                }
+            });
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("worker 1 terminated abnormally") != std::string::npos);
+            throw;
+        }
+    });
+#endif
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(ParallelizeRangeProcess, Output) {
+    testing::internal::CaptureStdout();
+    std::printf("PARENT\n"); // checking that this is not duplicated by the children.
+    subpar::parallelize_range_process(3, 10, [&](int w, int, int) -> void {
+        std::printf("WORKER%d\n", w);
+    });
+    const auto output = testing::internal::GetCapturedStdout();
+
+    EXPECT_EQ(output.find("PARENT"), output.rfind("PARENT"));
+    for (int w = 0; w < 3; ++w) {
+        EXPECT_NE(output.find("WORKER" + std::to_string(w)), std::string::npos);
+    }
+}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(ParallelizeRangeProcess, SetupFailure) {
+    // Restricting the number of file descriptors so that we can only create pipes for the first two workers.
+    const int lowest = dup(0);
+    ASSERT_GE(lowest, 0);
+    close(lowest);
+
+    struct rlimit original;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &original), 0);
+    struct rlimit restricted = original;
+    restricted.rlim_cur = lowest + 3;
+
+    auto run = [&](bool fail) -> std::string {
+        std::string message;
+        EXPECT_EQ(setrlimit(RLIMIT_NOFILE, &restricted), 0);
+        try {
+            subpar::parallelize_range_process(4, 100, [&](int w, int, int) -> void {
+                if (fail) {
+                    throw std::runtime_error("WHEE" + std::to_string(w));
+                }
+            });
+        } catch (std::exception& e) {
+            message = e.what();
+        }
+        EXPECT_EQ(setrlimit(RLIMIT_NOFILE, &original), 0);
+        return message;
+    };
+
+    // Errors from the children take precedence as they have lower worker IDs.
+    EXPECT_EQ(run(true), "WHEE0");
+    EXPECT_EQ(run(false), "failed to create a pipe for worker 2");
+}
+#endif
@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <ctime>
+
+#include "subpar/recursive.hpp"
+
+static void recursive_sum(subpar::RecursiveContext& ctx, const int* ptr, int n, long long& output, std::vector<int>& seen_workers) {
+    seen_workers[ctx.worker()] = 1;
+    if (n < 100) {
+        output = std::accumulate(ptr, ptr + n, 0LL);
+        return;
+    }
+
+    long long left = 0, right = 0;
+    ctx.spawn([&](subpar::RecursiveContext& child) -> void { recursive_sum(child, ptr, n / 2, left, seen_workers); });
+    recursive_sum(ctx, ptr + n / 2, n - n / 2, right, seen_workers);
+    ctx.wait();
+    output = left + right;
+}
+
+TEST(ParallelizeRecursive, Sum) {
+    std::vector<int> values(100000);
+    std::iota(values.begin(), values.end(), 0);
+    const long long expected = std::accumulate(values.begin(), values.end(), 0LL);
+
+    for (int nw : { -1, 0, 1, 2, 3, 8 }) {
+        std::vector<int> seen_workers(std::max(nw, 1));
+        long long total = 0;
+        int used = subpar::parallelize_recursive(nw, [&](subpar::RecursiveContext& ctx) -> void {
+            EXPECT_EQ(ctx.worker(), 0);
+            EXPECT_EQ(ctx.depth(), 0);
+            recursive_sum(ctx, values.data(), values.size(), total, seen_workers);
+        });
+        EXPECT_EQ(used, std::max(nw, 1));
+        EXPECT_EQ(total, expected);
+        EXPECT_EQ(seen_workers[0], 1);
+    }
+}
+
+static void recursive_sort(subpar::RecursiveContext& ctx, int* start, int* end) {
+    if (end - start < 1000) {
+        std::sort(start, end);
+        return;
+    }
+
+    const int pivot = *(start + (end - start) / 2);
+    int* middle1 = std::partition(start, end, [&](int x) -> bool { return x < pivot; });
+    int* middle2 = std::partition(middle1, end, [&](int x) -> bool { return x == pivot; });
+    ctx.spawn([=](subpar::RecursiveContext& child) -> void { recursive_sort(child, start, middle1); });
+    ctx.spawn([=](subpar::RecursiveContext& child) -> void { recursive_sort(child, middle2, end); });
+}
+
+TEST(ParallelizeRecursive, Quicksort) {
+    std::vector<int> values(200000);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = (i * 7919) % 100003;
+    }
+    auto expected = values;
+    std::sort(expected.begin(), expected.end());
+
+    // Children are implicitly waited on when the parent returns.
+    subpar::parallelize_recursive(4, [&](subpar::RecursiveContext& ctx) -> void {
+        recursive_sort(ctx, values.data(), values.data() + values.size());
+    });
+    EXPECT_EQ(values, expected);
+}
+
+static void recursive_tree(subpar::RecursiveContext& ctx, int remaining, std::atomic<int>& count, std::atomic<int>& max_depth, std::atomic<int>& bad_worker, int num_workers) {
+    ++count;
+    int current = max_depth.load();
+    while (ctx.depth() > current && !max_depth.compare_exchange_weak(current, ctx.depth())) {}
+    if (ctx.worker() < 0 || ctx.worker() >= num_workers) {
+        ++bad_worker;
+    }
+
+    if (remaining == 0) {
+        return;
+    }
+    for (int i = 0; i < 2; ++i) {
+        ctx.spawn([&,remaining](subpar::RecursiveContext& child) -> void {
+            recursive_tree(child, remaining - 1, count, max_depth, bad_worker, num_workers);
+        });
+    }
+}
+
+TEST(ParallelizeRecursive, DepthCutoff) {
+    for (int cutoff : { 0, 3, 100 }) {
+        std::atomic<int> count(0), max_depth(0), bad_worker(0);
+        subpar::parallelize_recursive(5, [&](subpar::RecursiveContext& ctx) -> void {
+            recursive_tree(ctx, 10, count, max_depth, bad_worker, 5);
+        }, cutoff);
+
+        // All tasks are still executed, and depth is still tracked correctly for tasks executed immediately.
+        EXPECT_EQ(count.load(), (1 << 11) - 1);
+        EXPECT_EQ(max_depth.load(), 10);
+        EXPECT_EQ(bad_worker.load(), 0);
+    }
+}
+
+TEST(ParallelizeRecursive, Errors) {
+    EXPECT_ANY_THROW({
+        try {
+            subpar::parallelize_recursive(3, [&](subpar::RecursiveContext& ctx) -> void {
+                for (int i = 0; i < 10; ++i) {
+                    ctx.spawn([i](subpar::RecursiveContext&) -> void {
+                        if (i == 5) {
+                            throw std::runtime_error("WHEE");
+                        }
+                    });
+                }
+            });
+        } catch (std::exception& e) {
+            EXPECT_TRUE(std::string(e.what()).find("WHEE") != std::string::npos);
+            throw;
+        }
+    });
+
+    EXPECT_ANY_THROW(subpar::parallelize_recursive(3, [&](subpar::RecursiveContext&) -> void { throw 1; }));
+
+    std::atomic<int> count(0);
+    subpar::parallelize_recursive<true>(3, [&](subpar::RecursiveContext& ctx) -> void {
+        for (int i = 0; i < 10; ++i) {
+            ctx.spawn([&](subpar::RecursiveContext&) -> void { ++count; });
+        }
+        ctx.wait();
+        EXPECT_EQ(count.load(), 10);
+    });
+
+    // Exceptions are not caught at all when nothrow_ = true.
+    EXPECT_DEATH({
+        subpar::parallelize_recursive<true>(3, [&](subpar::RecursiveContext& ctx) -> void {
+            ctx.spawn([](subpar::RecursiveContext&) -> void { throw std::runtime_error("lost"); });
+        });
+    }, "");
+}
+
+TEST(ParallelizeRecursive, MoveOnly) {
+    std::atomic<int> total(0);
+    subpar::parallelize_recursive(3, [&](subpar::RecursiveContext& ctx) -> void {
+        for (int i = 0; i < 10; ++i) {
+            auto value = std::make_unique<int>(i);
+            ctx.spawn([&,value=std::move(value)](subpar::RecursiveContext&) -> void { total += *value; });
+        }
+    });
+    EXPECT_EQ(total.load(), 45);
+}
+
+TEST(ParallelizeRecursive, StolenWait) {
+    // The root's only child is stolen by another worker and takes a while, so the root has nothing to do but wait for it.
+    std::atomic<bool> stolen(false);
+    std::atomic<int> child_worker(-1);
+    std::clock_t waiting = 0;
+    subpar::parallelize_recursive(2, [&](subpar::RecursiveContext& ctx) -> void {
+        ctx.spawn([&](subpar::RecursiveContext& child) -> void {
+            child_worker = child.worker();
+            stolen = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        });
+        while (!stolen.load()) {
+            std::this_thread::yield();
+        }
+        auto start = std::clock();
+        ctx.wait();
+        waiting = std::clock() - start;
+    });
+    EXPECT_EQ(child_worker.load(), 1);
+
+    // Root should be sleeping rather than spinning, so it shouldn't use much CPU time while waiting.
+    EXPECT_LT(waiting, CLOCKS_PER_SEC / 10);
+}